@@ -5,11 +5,16 @@
 # Based on bloat_test.sh from https://github.com/c42f/tinyformat.
 
 from __future__ import print_function
-import os, re, sys
+import argparse, os, re, sys, time
+from concurrent.futures import ThreadPoolExecutor
 from contextlib import ExitStack
 from glob import glob
-from subprocess import check_call, Popen, PIPE, CalledProcessError
-from timeit import timeit
+from subprocess import check_call, check_output, Popen, PIPE
+
+parser = argparse.ArgumentParser(allow_abbrev=False)
+parser.add_argument('-j', '--jobs', type=int, default=os.cpu_count(),
+                    help='number of translation units to compile in parallel')
+options, extra_flags = parser.parse_known_args()
 
 template = r'''
 #ifdef USE_BOOST
@@ -114,7 +119,7 @@ prefix = '/tmp/_bloat_test_tmp_'
 num_translation_units = 100
 
 # Remove old files.
-filenames = glob(prefix + '??.cc')
+filenames = glob(prefix + '???.cc') + glob(prefix + '*.o')
 for f in [prefix + 'main.cc', prefix + 'all.h']:
   if os.path.exists(f):
     filenames.append(f)
@@ -163,24 +168,92 @@ print('Using compiler', filename)
 class Result:
   pass
 
-# Measure compile time and executable size.
+# Runs command and returns its rusage. Uses wait4 rather than getrusage
+# (RUSAGE_CHILDREN) because the latter accumulates over all children of
+# this process which are compiled concurrently.
+def run(command):
+  p = Popen(command)
+  _, status, rusage = os.wait4(p.pid, 0)
+  p.returncode = os.waitstatus_to_exitcode(status)
+  if p.returncode != 0:
+    raise Exception('command failed: ' + ' '.join(command))
+  return rusage
+
+# Returns peak RSS in KiB (ru_maxrss is in bytes on macOS and KiB elsewhere).
+def max_rss_kib(rusage):
+  if sys.platform == 'darwin':
+    return rusage.ru_maxrss // 1024
+  return rusage.ru_maxrss
+
+def is_link_flag(flag):
+  return flag.startswith(('-l', '-L')) or \
+         flag.endswith(('.so', '.dylib', '.a'))
+
+# Symbol name prefixes used to attribute executable size to libraries.
+symbol_groups = [
+  ('fmt', re.compile(r'(\b|_)fmt::')),
+  ('IOStreams', re.compile(
+    r'std::(__1::|__cxx11::)?(basic_(i|o|io)stream|basic_(string|file)?buf|'
+    r'basic_ios|ios_base|num_put|locale|operator<<|endl|__ostream_insert)')),
+  ('tinyformat', re.compile(r'tinyformat::')),
+  ('Boost', re.compile(r'boost::')),
+  ('Folly', re.compile(r'folly::')),
+  ('stb_sprintf', re.compile(r'stbsp_')),
+]
+
+# Returns the total size of symbols in the executable attributed to each of
+# symbol_groups using nm --size-sort.
+def symbol_sizes(filename):
+  sizes = {group: 0 for group, _ in symbol_groups}
+  sizes['other'] = 0
+  output = check_output(['nm', '--size-sort', '-S', '-C', filename])
+  for line in output.decode('utf-8', 'replace').splitlines():
+    # Each line is "<address> <size> <type> <name>".
+    fields = line.split(None, 3)
+    if len(fields) < 4 or fields[2] in 'Uuw':
+      continue
+    size = int(fields[1], 16)
+    name = fields[3]
+    for group, pattern in symbol_groups:
+      if pattern.search(name):
+        sizes[group] += size
+        break
+    else:
+      sizes['other'] += size
+  return sizes
+
+# Measure compile time and executable size. Each translation unit is compiled
+# separately in parallel and then linked.
 expected_output = None
 def benchmark(flags):
   output_filename = prefix + '.out'
   if os.path.exists(output_filename):
     os.remove(output_filename)
   include_dir = '-I' + os.path.dirname(os.path.realpath(__file__))
-  command = 'check_call({})'.format(
-    [compiler_path, '-std=c++17', '-o', output_filename, include_dir] + sources + flags)
+  compile_flags = [f for f in flags if not is_link_flag(f)]
+  objects = [os.path.splitext(s)[0] + '.o' for s in sources]
+  def compile(source, obj):
+    return run([compiler_path, '-std=c++17', '-c', '-o', obj, include_dir,
+                source] + compile_flags)
   result = Result()
+  start = time.perf_counter()
   try:
-    result.time = timeit(
-      command, setup = 'from subprocess import check_call', number = 1)
-  except CalledProcessError:
+    with ThreadPoolExecutor(max_workers=options.jobs) as executor:
+      usages = list(executor.map(compile, sources, objects))
+    run([compiler_path, '-o', output_filename] + objects + flags)
+  except Exception:
     return None
-  print('Compile time: {:.2f}s'.format(result.time))
+  result.time = time.perf_counter() - start
+  cpu_times = [u.ru_utime + u.ru_stime for u in usages]
+  result.cpu_time = sum(cpu_times)
+  result.max_tu_cpu_time = max(cpu_times)
+  result.max_rss = max(max_rss_kib(u) for u in usages)
+  print('Compile time: {:.2f}s, CPU time: {:.2f}s, max TU CPU time: {:.2f}s, '
+        'peak RSS: {} KiB'.format(result.time, result.cpu_time,
+                                  result.max_tu_cpu_time, result.max_rss))
   result.size = os.stat(output_filename).st_size
   print('Size: {}'.format(result.size))
+  result.symbol_sizes = symbol_sizes(output_filename)
   check_call(['strip', output_filename])
   result.stripped_size = os.stat(output_filename).st_size
   print('Stripped size: {}'.format(result.stripped_size))
@@ -255,7 +328,7 @@ for config, flags in configs:
         continue
       print('Benchmarking', config, method)
       sys.stdout.flush()
-      new_result = benchmark(flags + method_flags + sys.argv[1:])
+      new_result = benchmark(flags + method_flags + extra_flags)
       if not new_result:
         exclude_list.append(method)
         print(method + ' is not available')
@@ -265,17 +338,34 @@ for config, flags in configs:
         continue
       old_result = results[method]
       old_result.time = min(old_result.time, new_result.time)
+      old_result.cpu_time = min(old_result.cpu_time, new_result.cpu_time)
+      old_result.max_tu_cpu_time = \
+        min(old_result.max_tu_cpu_time, new_result.max_tu_cpu_time)
+      old_result.max_rss = min(old_result.max_rss, new_result.max_rss)
       if new_result.size != old_result.size or \
          new_result.stripped_size != old_result.stripped_size:
         raise Exception('size mismatch')
   print(config, 'Results:')
   table = [
-    ('Method', 'Compile Time, s', 'Executable size, KiB', 'Stripped size, KiB')
+    ('Method', 'Compile Time, s', 'CPU Time, s', 'Max TU CPU Time, s',
+     'Peak RSS, MiB', 'Executable size, KiB', 'Stripped size, KiB')
   ]
   for method, method_flags in methods:
     if method not in results:
       continue
     result = results[method]
     table.append(
-      (method, result.time, to_kib(result.size), to_kib(result.stripped_size)))
-  print_table(table, '', '.1f', '', '')
+      (method, result.time, result.cpu_time, result.max_tu_cpu_time,
+       result.max_rss / 1024.0, to_kib(result.size),
+       to_kib(result.stripped_size)))
+  print_table(table, '', '.1f', '.1f', '.2f', '.1f', '', '')
+  print()
+  print(config, 'Symbol sizes, KiB:')
+  groups = [group for group, _ in symbol_groups] + ['other']
+  table = [['Method'] + groups]
+  for method, method_flags in methods:
+    if method not in results:
+      continue
+    sizes = results[method].symbol_sizes
+    table.append([method] + [to_kib(sizes[group]) for group in groups])
+  print_table(table, *([''] * len(table[0])))
@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+
+# Script to measure the compile-time cost of formatting headers. It builds
+# generated translation units with clang's -ftime-trace and aggregates the
+# JSON traces into per-header parse, instantiation and code generation times.
+
+import argparse
+import json
+import os
+import re
+import sys
+from concurrent.futures import ThreadPoolExecutor
+from glob import glob
+from subprocess import check_call
+
+from rst_table import print_table
+
+parser = argparse.ArgumentParser(allow_abbrev=False)
+parser.add_argument('-n', '--num-translation-units', type=int, default=20,
+                    help='number of translation units per header')
+parser.add_argument('-j', '--jobs', type=int, default=os.cpu_count(),
+                    help='number of translation units to compile in parallel')
+parser.add_argument('--compiler', default='clang++',
+                    help='clang compiler to use (-ftime-trace is required)')
+options, extra_flags = parser.parse_known_args()
+
+prefix = '/tmp/_header_cost_test_tmp_'
+
+# Each header is included into otherwise empty translation units together
+# with a typical use so that the traces include instantiation and code
+# generation and not just parsing.
+headers = [
+  ('(none)', None, '', r'''
+void doFormat_a() {}
+'''),
+  ('fmt/base.h', 'fmt/base.h', '#include "fmt/base.h"', r'''
+void doFormat_a() {
+  fmt::print("{}:{}\n", "somefile.cpp", 42);
+}
+'''),
+  ('fmt/format.h', 'fmt/format.h', '#include "fmt/format.h"', r'''
+void doFormat_a() {
+  auto s = fmt::format("{}:{}:{:.2f}\n", "somefile.cpp", 42, 4.2);
+  fmt::print("{}", s);
+}
+'''),
+  ('fmt/compile.h', 'fmt/compile.h', '#include "fmt/compile.h"', r'''
+void doFormat_a() {
+  char buf[100];
+  auto end = fmt::format_to(buf, FMT_COMPILE("{}:{}\n"), "somefile.cpp", 42);
+  fmt::print("{}", fmt::string_view(buf, end - buf));
+}
+'''),
+  ('tinyformat.h', 'tinyformat.h', '#include "src/tinyformat.h"', r'''
+void doFormat_a() {
+  tfm::printf("%s:%d\n", "somefile.cpp", 42);
+}
+'''),
+  ('<iostream>', 'iostream', '#include <iostream>', r'''
+void doFormat_a() {
+  std::cout << "somefile.cpp:" << 42 << "\n";
+}
+'''),
+]
+
+configs = [
+  ('optimized', ['-O3', '-DNDEBUG']),
+  ('debug',     [])
+]
+
+
+def remove_old_files():
+  for f in glob(prefix + '*'):
+    os.remove(f)
+
+
+def generate_files(name, include, body):
+  sources = []
+  slug = re.sub('[^a-z]+', '_', name)
+  for i in range(options.num_translation_units):
+    n = '{:03}'.format(i)
+    source = '{}{}_{}.cc'.format(prefix, slug, n)
+    with open(source, 'w') as f:
+      f.write(include + '\n')
+      f.write(body.replace('doFormat_a', 'doFormat_a' + n)
+                  .replace('42', str(i)))
+    sources.append(source)
+  return sources
+
+
+def compile(source, flags):
+  obj = os.path.splitext(source)[0] + '.o'
+  root = os.path.dirname(os.path.realpath(__file__))
+  check_call([options.compiler, '-std=c++17', '-c', '-o', obj, '-ftime-trace',
+              '-ftime-trace-granularity=0', '-I' + root,
+              '-I' + os.path.join(root, 'fmt', 'include'), source] +
+             flags + extra_flags)
+  # clang writes the trace next to the object file.
+  return os.path.splitext(obj)[0] + '.json'
+
+
+class Times:
+  def __init__(self):
+    self.parse = 0
+    self.instantiate = 0
+    self.codegen = 0
+    self.total = 0
+
+
+def analyze_trace(filename, header_path):
+  """Returns times in microseconds for a single trace."""
+  with open(filename) as f:
+    events = json.load(f)['traceEvents']
+  totals = {}
+  times = Times()
+  for e in events:
+    name = e.get('name', '')
+    dur = e.get('dur', 0)
+    if name.startswith('Total '):
+      totals[name[len('Total '):]] = dur
+    elif name == 'Source' and header_path and \
+         e.get('args', {}).get('detail', '').endswith('/' + header_path):
+      # Headers are included once because of include guards so the longest
+      # Source event for the header is the outermost one which includes the
+      # time to parse everything the header includes.
+      times.parse = max(times.parse, dur)
+  times.instantiate = totals.get('InstantiateFunction', 0) + \
+                      totals.get('InstantiateClass', 0)
+  if 'Backend' in totals:
+    times.codegen = totals['Backend']
+  else:
+    times.codegen = totals.get('CodeGen Function', 0) + \
+                    totals.get('OptModule', 0)
+  times.total = totals.get('ExecuteCompiler', 0)
+  return times
+
+
+def bench(config_flags):
+  results = []
+  for name, header_path, include, body in headers:
+    print('Compiling', name)
+    sys.stdout.flush()
+    sources = generate_files(name, include, body)
+    with ThreadPoolExecutor(max_workers=options.jobs) as executor:
+      traces = list(executor.map(lambda s: compile(s, config_flags), sources))
+    times = [analyze_trace(t, header_path) for t in traces]
+    result = Times()
+    for attr in 'parse', 'instantiate', 'codegen', 'total':
+      setattr(result, attr,
+              sum(getattr(t, attr) for t in times) / len(times) / 1000)
+    results.append((name, result))
+  return results
+
+
+if __name__ == '__main__':
+  for config, config_flags in configs:
+    remove_old_files()
+    results = bench(config_flags)
+    results.sort(key=lambda r: r[1].total, reverse=True)
+    print(config, 'Results (average per translation unit):')
+    table = [('Header', 'Parse, ms', 'Instantiation, ms', 'Codegen, ms',
+              'Total, ms')]
+    for name, t in results:
+      table.append((name, t.parse, t.instantiate, t.codegen, t.total))
+    print_table(table, '', '.1f', '.1f', '.1f', '.1f')
+    print()
@@ -0,0 +1,248 @@
+#!/usr/bin/env python3
+
+# Script to measure the run-time cost of many distinct format strings. It
+# generates N call sites, each with its own format string, calls them in
+# random order with FMT_COMPILE and with runtime format strings and reports
+# throughput together with instruction cache and iTLB misses from perf stat.
+#
+# Usage:
+#   icache-test.py bench [--sites 10 100 1000 10000]
+#   icache-test.py plot
+
+import argparse
+import os
+import pickle
+import re
+import shutil
+import sys
+from concurrent.futures import ThreadPoolExecutor
+from glob import glob
+from subprocess import PIPE, Popen, check_call
+
+from rst_table import print_table
+
+parser = argparse.ArgumentParser()
+subparsers = parser.add_subparsers(help='possible commands', dest='command')
+
+parser_bench = subparsers.add_parser('bench', help='run the benchmark')
+parser_bench.add_argument('--sites', type=int, nargs='+',
+                          default=[10, 100, 1000, 3000, 10000],
+                          help='numbers of call sites')
+parser_bench.add_argument('--sites-per-tu', type=int, default=250,
+                          help='number of call sites per translation unit')
+parser_bench.add_argument('-j', '--jobs', type=int, default=os.cpu_count(),
+                          help='number of translation units to compile in '
+                               'parallel')
+parser_bench.add_argument('--compiler', default='c++', help='compiler to use')
+
+parser_plot = subparsers.add_parser('plot', help='plot the results')
+parser_plot.add_argument('--filename', type=str, default='icache-test.pkl',
+                         help='bench result file path')
+
+options, extra_flags = parser.parse_known_args()
+
+if options.command == 'plot':
+  import matplotlib.pyplot as plt
+
+prefix = '/tmp/_icache_test_tmp_'
+
+# The script is run from the build directory as bloat-test.py.
+fmt_library = 'fmt/libfmt.so'
+
+methods = [
+  ('FMT_COMPILE', 'FMT_COMPILE("{}")'),
+  ('runtime',     'fmt::runtime("{}")')
+]
+
+# Specifiers are varied between sites so that compiled format strings produce
+# different code and not just different literals.
+int_specs = ['{}', '{:x}', '{:08}', '{:>6}', '{:+}']
+double_specs = ['{}', '{:.2f}', '{:e}', '{:g}']
+string_specs = ['{}', '{:>10}', '{:.3}']
+
+# perf events and their names in the results.
+events = [
+  ('instructions', 'instructions'),
+  ('L1-icache-load-misses', 'icache_misses'),
+  ('iTLB-load-misses', 'itlb_misses')
+]
+
+main_source = r'''
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using site = char* (*)(char*, int, double, const char*);
+extern const site sites[];
+extern const unsigned num_sites;
+
+int main() {
+  std::vector<unsigned> order(1'000'000);
+  std::mt19937 gen;
+  std::uniform_int_distribution<unsigned> dist(0, num_sites - 1);
+  for (auto& i : order) i = dist(gen);
+  char buffer[256];
+  size_t size = 0;
+  auto call_all = [&]() {
+    for (unsigned i : order) {
+      size += sites[i](buffer, static_cast<int>(i), i * 0.5, "str") - buffer;
+    }
+  };
+  call_all();  // Warm up.
+  auto start = std::chrono::steady_clock::now();
+  call_all();
+  auto end = std::chrono::steady_clock::now();
+  std::printf("%f %zu\n",
+              std::chrono::duration<double, std::nano>(end - start).count() /
+                  order.size(), size);
+}
+'''
+
+
+def remove_old_files():
+  for f in glob(prefix + '*'):
+    os.remove(f)
+
+
+def format_string(i):
+  return 'site {}: {} {} {}\\n'.format(
+    i, int_specs[i % len(int_specs)],
+    double_specs[i // len(int_specs) % len(double_specs)],
+    string_specs[i % len(string_specs)])
+
+
+def generate_files(num_sites, method):
+  sources = []
+  wrap = dict(methods)[method]
+  for start in range(0, num_sites, options.sites_per_tu):
+    source = '{}{:05}.cc'.format(prefix, start)
+    with open(source, 'w') as f:
+      f.write('#include <fmt/compile.h>\n\n')
+      for i in range(start, min(start + options.sites_per_tu, num_sites)):
+        f.write('char* site{0}(char* out, int a, double b, const char* c) {{\n'
+                '  return fmt::format_to(out, {1}, a, b, c);\n'
+                '}}\n'.format(i, wrap.format(format_string(i))))
+    sources.append(source)
+  source = prefix + 'main.cc'
+  with open(source, 'w') as f:
+    f.write(main_source)
+    f.write('\nchar* site{}(char*, int, double, const char*);'.format(
+      '(char*, int, double, const char*);\nchar* site'.join(
+        str(i) for i in range(num_sites))))
+    f.write('\nextern const site sites[] = {{{}}};\n'.format(
+      ', '.join('site{}'.format(i) for i in range(num_sites))))
+    f.write('extern const unsigned num_sites = {};\n'.format(num_sites))
+  sources.append(source)
+  return sources
+
+
+def compile(source):
+  root = os.path.dirname(os.path.realpath(__file__))
+  obj = os.path.splitext(source)[0] + '.o'
+  check_call([options.compiler, '-std=c++17', '-O3', '-DNDEBUG', '-c',
+              '-o', obj, '-I' + os.path.join(root, 'fmt', 'include'), source] +
+             extra_flags)
+  return obj
+
+
+def run(binary):
+  """Runs the binary under perf stat if available and returns the results"""
+  perf = shutil.which('perf')
+  cmd = [binary]
+  if perf:
+    cmd = [perf, 'stat', '-x', ',', '-e',
+           ','.join(e for e, _ in events)] + cmd
+  env = dict(os.environ, LD_LIBRARY_PATH='fmt', DYLD_LIBRARY_PATH='fmt')
+  p = Popen(cmd, stdout=PIPE, stderr=PIPE, env=env)
+  out, err = p.communicate()
+  if p.returncode != 0:
+    raise Exception('{} failed: {}'.format(binary, err.decode()))
+  result = {'ns_per_call': float(out.split()[0])}
+  # perf stat -x prints <value>,<unit>,<event>,... and counts the whole
+  # process including the warmup and setup so only ratios are meaningful.
+  counts = {}
+  for line in err.decode().splitlines():
+    fields = line.split(',')
+    if len(fields) > 2 and re.match(r'\d+$', fields[0]):
+      counts[fields[2].split(':')[0]] = int(fields[0])
+  instructions = counts.get('instructions')
+  for event, name in events[1:]:
+    if instructions and event in counts:
+      result[name + '_per_kinsn'] = counts[event] * 1000.0 / instructions
+  return result
+
+
+def bench_command():
+  data = {'options': options}
+  for method, _ in methods:
+    data[method] = []
+    for num_sites in options.sites:
+      print('Benchmarking {} with {} sites'.format(method, num_sites))
+      sys.stdout.flush()
+      remove_old_files()
+      sources = generate_files(num_sites, method)
+      with ThreadPoolExecutor(max_workers=options.jobs) as executor:
+        objects = list(executor.map(compile, sources))
+      binary = prefix + 'test'
+      check_call([options.compiler, '-o', binary] + objects +
+                 [fmt_library if os.path.exists(fmt_library) else '-lfmt'] +
+                 extra_flags)
+      result = run(binary)
+      result['sites'] = num_sites
+      result['binary_size'] = os.path.getsize(binary)
+      data[method].append(result)
+  remove_old_files()
+  with open('icache-test.pkl', 'wb') as f:
+    pickle.dump(data, f)
+  print_results(data)
+
+
+def print_results(data):
+  table = [('Method', 'Sites', 'ns/call', 'Mcalls/s',
+            'I-cache misses/kinsn', 'iTLB misses/kinsn')]
+  for method, _ in methods:
+    for r in data[method]:
+      table.append((method, r['sites'], r['ns_per_call'],
+                    1000 / r['ns_per_call'],
+                    r.get('icache_misses_per_kinsn', float('nan')),
+                    r.get('itlb_misses_per_kinsn', float('nan'))))
+  print_table(table, '', '', '.1f', '.1f', '.2f', '.3f')
+
+
+def plot_command():
+  with open(options.filename, 'rb') as f:
+    data = pickle.load(f)
+  props = [('ns_per_call', 'throughput (Mcalls/s)', lambda y: 1000 / y),
+           ('icache_misses_per_kinsn', 'I-cache misses / 1000 insns', None),
+           ('itlb_misses_per_kinsn', 'iTLB misses / 1000 insns', None)]
+  props = [p for p in props if p[0] in data[methods[0][0]][0]]
+  plt.figure(figsize=(4 * len(props), 3.5))
+  for i, (prop, label, transform) in enumerate(props):
+    plt.subplot(1, len(props), i + 1)
+    for method, _ in methods:
+      x = [r['sites'] for r in data[method]]
+      y = [r[prop] for r in data[method]]
+      if transform:
+        y = [transform(v) for v in y]
+      plt.plot(x, y, marker='o', label=method)
+    plt.xscale('log')
+    plt.xlabel('number of call sites')
+    plt.ylabel(label)
+    plt.grid(color='k', alpha=0.4, ls=':')
+  plt.legend()
+  plt.suptitle('icache-test')
+  plt.tight_layout()
+  plt.savefig('icache-test.png', bbox_inches='tight')
+
+
+commands = {
+  'bench': bench_command,
+  'plot': plot_command,
+}
+
+if __name__ == '__main__':
+  if options.command not in commands:
+    parser.print_help()
+    sys.exit(1)
+  commands[options.command]()
@@ -0,0 +1,33 @@
+# Helpers shared by the test scripts to print results as reStructuredText
+# tables.
+
+from __future__ import print_function
+
+
+def format_field(field, format='', width=''):
+  return '{:{}{}}'.format(field, width, format)
+
+
+def print_rulers(widths):
+  for w in widths:
+    print('=' * w, end=' ')
+  print()
+
+
+# Prints a reStructuredText table.
+def print_table(table, *formats):
+  widths = [len(i) for i in table[0]]
+  for row in table[1:]:
+    for i in range(len(row)):
+      widths[i] = max(widths[i], len(format_field(row[i], formats[i])))
+  print_rulers(widths)
+  row = table[0]
+  for i in range(len(row)):
+    print(format_field(row[i], '', widths[i]), end=' ')
+  print()
+  print_rulers(widths)
+  for row in table[1:]:
+    for i in range(len(row)):
+      print(format_field(row[i], formats[i], widths[i]), end=' ')
+    print()
+  print_rulers(widths)
@@ -0,0 +1,308 @@
+#!/usr/bin/env python3
+
+# Script to run all benchmarks, store the results in a common JSON format and
+# compare stored runs to detect regressions.
+#
+# Usage:
+#   run-benchmarks.py run <build-dir>
+#   run-benchmarks.py compare <baseline.json> <candidate.json>
+
+import argparse
+import datetime
+import json
+import math
+import os
+import platform
+import re
+import statistics
+import sys
+import tempfile
+import time
+from glob import glob
+from subprocess import DEVNULL, PIPE, Popen, check_call, check_output
+
+from rst_table import print_table
+
+SCHEMA_VERSION = 1
+
+parser = argparse.ArgumentParser()
+subparsers = parser.add_subparsers(help='possible commands', dest='command')
+
+parser_run = subparsers.add_parser('run', help='run the benchmarks')
+parser_run.add_argument('build_dir', help='CMake build directory')
+parser_run.add_argument('--output-dir', default='benchmark-results',
+                        help='directory to store the results in')
+parser_run.add_argument('--repetitions', type=int, default=5,
+                        help='number of repetitions of each benchmark')
+parser_run.add_argument('--filter', default='',
+                        help='regular expression matching targets to run')
+
+parser_compare = subparsers.add_parser(
+  'compare', help='compare two stored runs and report regressions')
+parser_compare.add_argument('baseline', help='baseline result file')
+parser_compare.add_argument('candidate', help='candidate result file')
+parser_compare.add_argument('--alpha', type=float, default=0.05,
+                            help='significance level')
+parser_compare.add_argument('--threshold', type=float, default=0.02,
+                            help='minimum relative slowdown to report')
+
+# Benchmarks that don't use Google Benchmark.
+itoa_benchmark = 'itoa-benchmark'
+speed_test = 'tinyformat_speed_test'
+speed_test_methods = ['printf', 'iostreams', 'format', 'fmt::compile',
+                      'tinyformat', 'boost', 'folly', 'stb_sprintf']
+
+time_units = {'ns': 1, 'us': 1e3, 'ms': 1e6, 's': 1e9}
+
+
+def read_cmake_cache(build_dir):
+  cache = {}
+  with open(os.path.join(build_dir, 'CMakeCache.txt')) as f:
+    for line in f:
+      m = re.match(r'([^#/][^:]*):[^=]*=(.*)', line)
+      if m:
+        cache[m.group(1)] = m.group(2)
+  return cache
+
+
+def git_revision(path):
+  try:
+    return {
+      'revision': check_output(['git', '-C', path, 'rev-parse', 'HEAD'],
+                               stderr=DEVNULL).decode().strip(),
+      'describe': check_output(
+        ['git', '-C', path, 'describe', '--tags', '--always', '--dirty'],
+        stderr=DEVNULL).decode().strip()
+    }
+  except Exception:
+    return {'revision': 'unknown', 'describe': 'unknown'}
+
+
+def cpu_model():
+  if sys.platform == 'darwin':
+    return check_output(
+      ['sysctl', '-n', 'machdep.cpu.brand_string']).decode().strip()
+  try:
+    with open('/proc/cpuinfo') as f:
+      m = re.search(r'model name\s*:\s*(.*)', f.read())
+      if m:
+        return m.group(1)
+  except IOError:
+    pass
+  return platform.processor()
+
+
+def collect_metadata(build_dir):
+  cache = read_cmake_cache(build_dir)
+  compiler = cache.get('CMAKE_CXX_COMPILER', 'c++')
+  try:
+    version = check_output([compiler, '--version']).decode().splitlines()[0]
+  except Exception:
+    version = 'unknown'
+  source_dir = cache.get('FORMAT_BENCHMARKS_SOURCE_DIR', '.')
+  return {
+    'machine': {
+      'hostname': platform.node(),
+      'platform': platform.platform(),
+      'arch': platform.machine(),
+      'cpu': cpu_model(),
+      'num_cpus': os.cpu_count()
+    },
+    'compiler': {
+      'path': compiler,
+      'version': version,
+      'build_type': cache.get('CMAKE_BUILD_TYPE', ''),
+      'flags': cache.get('CMAKE_CXX_FLAGS', '')
+    },
+    'fmt': git_revision(os.path.join(source_dir, 'fmt')),
+    'format-benchmark': git_revision(source_dir)
+  }
+
+
+def result(target, name, samples):
+  return {'target': target, 'name': name, 'unit': 'ns', 'samples': samples}
+
+
+def run_google_benchmark(path, repetitions):
+  """Runs a Google Benchmark target and returns normalized results"""
+  target = os.path.basename(path)
+  with tempfile.TemporaryDirectory() as tmp:
+    out = os.path.join(tmp, 'out.json')
+    check_call([path, '--benchmark_out=' + out,
+                '--benchmark_out_format=json',
+                '--benchmark_repetitions={}'.format(repetitions)],
+               stdout=DEVNULL)
+    with open(out) as f:
+      data = json.load(f)
+  samples = {}
+  for b in data['benchmarks']:
+    if b.get('run_type', 'iteration') != 'iteration':
+      continue
+    name = b.get('run_name', b['name'])
+    scale = time_units[b.get('time_unit', 'ns')]
+    samples.setdefault(name, []).append(b['real_time'] * scale)
+  results = [result(target, name, s) for name, s in samples.items()]
+  return results, data.get('context', {})
+
+
+def run_itoa_benchmark(path):
+  """Runs itoa-benchmark and converts the CSV it writes"""
+  target = os.path.basename(path)
+  results = []
+  # itoa-benchmark writes RESULT_FILENAME to the current directory unless it
+  # finds result/template.php in one of the parent directories.
+  with tempfile.TemporaryDirectory() as tmp:
+    cwd = os.path.join(tmp, 'a', 'b')
+    os.makedirs(cwd)
+    check_call([os.path.abspath(path)], cwd=cwd, stdout=DEVNULL)
+    for filename in glob(os.path.join(cwd, '*.csv')):
+      with open(filename) as f:
+        next(f)  # Skip the header.
+        for line in f:
+          type, function, digit, time_ns = line.strip().split(',')
+          results.append(result(target, '/'.join((type, function, digit)),
+                                [float(time_ns)]))
+  return results
+
+
+def run_speed_test(path, repetitions):
+  """Times tinyformat_speed_test for each method"""
+  target = 'speed-test'
+  results = []
+  for method in speed_test_methods:
+    samples = []
+    for i in range(repetitions):
+      start = time.perf_counter()
+      p = Popen([path, method], stdout=DEVNULL, stderr=PIPE)
+      err = p.communicate()[1]
+      samples.append((time.perf_counter() - start) * 1e9)
+      if p.returncode != 0 or b'not available' in err:
+        samples = None
+        break
+    if samples:
+      results.append(result(target, method, samples))
+  return results
+
+
+def run_command(options):
+  build_dir = options.build_dir
+  data = {'schema_version': SCHEMA_VERSION,
+          'timestamp': datetime.datetime.now().isoformat()}
+  data.update(collect_metadata(build_dir))
+  data['results'] = []
+  data['context'] = {}
+  # itoa-benchmark is built in a subdirectory so search recursively.
+  targets = sorted(
+    glob(os.path.join(build_dir, '**', '*-benchmark'), recursive=True))
+  targets.append(os.path.join(build_dir, speed_test))
+  for path in targets:
+    target = os.path.basename(path)
+    if not re.search(options.filter, target) or not os.path.isfile(path) or \
+       not os.access(path, os.X_OK):
+      continue
+    print('Running', target)
+    sys.stdout.flush()
+    if target == itoa_benchmark:
+      data['results'] += run_itoa_benchmark(path)
+    elif target == speed_test:
+      data['results'] += run_speed_test(path, options.repetitions)
+    else:
+      results, context = run_google_benchmark(path, options.repetitions)
+      data['results'] += results
+      data['context'][target] = context
+  if not os.path.exists(options.output_dir):
+    os.makedirs(options.output_dir)
+  filename = os.path.join(options.output_dir, '{}_{}.json'.format(
+    datetime.datetime.now().strftime('%Y%m%d-%H%M%S'),
+    data['fmt']['describe']))
+  with open(filename, 'w') as f:
+    json.dump(data, f, indent=2)
+  print('Results written to', filename)
+
+
+def mann_whitney_p(a, b):
+  """Returns a two-sided p-value of the Mann-Whitney U test using the normal
+  approximation with tie and continuity corrections."""
+  n1, n2 = len(a), len(b)
+  values = sorted([(v, 0) for v in a] + [(v, 1) for v in b])
+  ranks = [0.0] * len(values)
+  tie_term = 0
+  i = 0
+  while i < len(values):
+    j = i
+    while j + 1 < len(values) and values[j + 1][0] == values[i][0]:
+      j += 1
+    for k in range(i, j + 1):
+      ranks[k] = (i + j) / 2.0 + 1
+    t = j - i + 1
+    tie_term += t ** 3 - t
+    i = j + 1
+  r1 = sum(r for r, (_, group) in zip(ranks, values) if group == 0)
+  u = r1 - n1 * (n1 + 1) / 2.0
+  n = n1 + n2
+  sigma = math.sqrt(n1 * n2 / 12.0 * ((n + 1) - tie_term / (n * (n - 1))))
+  if sigma == 0:
+    return 1.0
+  z = (abs(u - n1 * n2 / 2.0) - 0.5) / sigma
+  return math.erfc(max(z, 0) / math.sqrt(2))
+
+
+def load_results(filename):
+  with open(filename) as f:
+    data = json.load(f)
+  if data.get('schema_version') != SCHEMA_VERSION:
+    raise Exception('unsupported schema version in ' + filename)
+  return data, {(r['target'], r['name']): r['samples']
+                for r in data['results']}
+
+
+def compare_command(options):
+  baseline_data, baseline = load_results(options.baseline)
+  candidate_data, candidate = load_results(options.candidate)
+  for key in 'machine', 'compiler':
+    if baseline_data[key] != candidate_data[key]:
+      print('Warning: {} differs between runs'.format(key))
+  print('fmt {} -> {}'.format(baseline_data['fmt']['describe'],
+                              candidate_data['fmt']['describe']))
+  table = [('Benchmark', 'Baseline, ns', 'Candidate, ns', 'Change', 'p-value',
+            'Status')]
+  num_regressions = 0
+  rows = []
+  for key in sorted(baseline.keys() & candidate.keys()):
+    a, b = baseline[key], candidate[key]
+    base, cand = statistics.median(a), statistics.median(b)
+    change = cand / base - 1 if base else 0
+    # Single-sample results such as itoa-benchmark can't be tested for
+    # significance so they are only reported as suspected.
+    if len(a) >= 3 and len(b) >= 3:
+      p = mann_whitney_p(a, b)
+      significant = p < options.alpha
+    else:
+      p = float('nan')
+      significant = None
+    status = ''
+    if change > options.threshold:
+      if significant:
+        status = 'REGRESSION'
+        num_regressions += 1
+      elif significant is None:
+        status = 'suspected'
+    elif change < -options.threshold and significant:
+      status = 'improvement'
+    rows.append((change, ('/'.join(key), base, cand,
+                          '{:+.1%}'.format(change), p, status)))
+  rows.sort(key=lambda r: r[0], reverse=True)
+  print_table(table + [row for _, row in rows], '', '.1f', '.1f', '', '.3f',
+              '')
+  print('{} significant regression(s)'.format(num_regressions))
+  return 1 if num_regressions else 0
+
+
+if __name__ == '__main__':
+  options = parser.parse_args()
+  if options.command == 'run':
+    run_command(options)
+  elif options.command == 'compare':
+    sys.exit(compare_command(options))
+  else:
+    parser.print_help()
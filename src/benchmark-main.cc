@@ -0,0 +1,216 @@
+// A replacement for BENCHMARK_MAIN that reduces and reports sources of
+// run-to-run noise. It pins the process to a single CPU, reports the
+// frequency governor, turbo and SMT sibling state, warms up until the CPU
+// frequency is stable and checks the load average. The results are added to
+// the benchmark context so that they end up in the JSON output.
+//
+// In addition to the Google Benchmark flags the following are accepted:
+//   --pin_cpu=<n>|auto|none  CPU to run on; auto picks the last CPU available
+//                            to the process (default: auto)
+//   --max_load=<x>           maximum 1-minute load average (default: 1.0)
+//   --warmup_ms=<n>          maximum warmup time in milliseconds
+//                            (default: 2000)
+//   --strict_env             exit with an error instead of annotating the
+//                            results when the environment is noisy
+//
+// Copyright (c) 2019 - present, Victor Zverovich
+// All rights reserved.
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#ifdef __linux__
+#  include <sched.h>
+#endif
+
+namespace {
+
+struct options {
+  int cpu = -1;  // -1 means auto.
+  bool pin = true;
+  double max_load = 1.0;
+  int warmup_ms = 2000;
+  bool strict = false;
+};
+
+bool parse_flag(const char* arg, const char* name, const char** value) {
+  auto len = std::strlen(name);
+  if (std::strncmp(arg, name, len) != 0) return false;
+  if (arg[len] == '\0') {
+    *value = nullptr;
+    return true;
+  }
+  if (arg[len] != '=') return false;
+  *value = arg + len + 1;
+  return true;
+}
+
+// Parses and removes the flags handled here from argv so that they are not
+// reported as unrecognized by benchmark::Initialize.
+options parse_options(int& argc, char** argv) {
+  options opts;
+  int out = 1;
+  for (int i = 1; i < argc; ++i) {
+    const char* value = nullptr;
+    if (parse_flag(argv[i], "--pin_cpu", &value) && value) {
+      if (std::strcmp(value, "none") == 0)
+        opts.pin = false;
+      else if (std::strcmp(value, "auto") != 0)
+        opts.cpu = std::atoi(value);
+    } else if (parse_flag(argv[i], "--max_load", &value) && value) {
+      opts.max_load = std::atof(value);
+    } else if (parse_flag(argv[i], "--warmup_ms", &value) && value) {
+      opts.warmup_ms = std::atoi(value);
+    } else if (parse_flag(argv[i], "--strict_env", &value) && !value) {
+      opts.strict = true;
+    } else {
+      argv[out++] = argv[i];
+    }
+  }
+  argc = out;
+  argv[argc] = nullptr;
+  return opts;
+}
+
+// Returns the first line of a file or an empty string if it can't be read.
+std::string read_line(const std::string& path) {
+  std::ifstream f(path);
+  std::string line;
+  std::getline(f, line);
+  return line;
+}
+
+std::string cpu_path(int cpu, const char* path) {
+  return "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + path;
+}
+
+// Pins the calling thread to the specified CPU or the last available one if
+// cpu is negative. Returns the CPU or -1 on error.
+int pin_to_cpu(int cpu) {
+#ifdef __linux__
+  cpu_set_t set;
+  if (sched_getaffinity(0, sizeof(set), &set) != 0) return -1;
+  for (int i = CPU_SETSIZE - 1; cpu < 0 && i >= 0; --i) {
+    if (CPU_ISSET(i, &set)) cpu = i;
+  }
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (sched_setaffinity(0, sizeof(set), &set) != 0) return -1;
+  return cpu;
+#else
+  return -1;
+#endif
+}
+
+std::string turbo_state() {
+  auto no_turbo = read_line("/sys/devices/system/cpu/intel_pstate/no_turbo");
+  if (!no_turbo.empty()) return no_turbo == "1" ? "disabled" : "enabled";
+  auto boost = read_line("/sys/devices/system/cpu/cpufreq/boost");
+  if (!boost.empty()) return boost == "0" ? "disabled" : "enabled";
+  return "unknown";
+}
+
+// Returns the number of iterations of a simple loop per nanosecond measured
+// over 10ms. It is proportional to the CPU frequency.
+double spin_rate() {
+  using clock = std::chrono::steady_clock;
+  auto start = clock::now();
+  auto end = start + std::chrono::milliseconds(10);
+  unsigned long n = 0;
+  while (clock::now() < end) {
+    for (int i = 0; i < 1000; ++i) benchmark::DoNotOptimize(n += i);
+  }
+  return n / std::chrono::duration<double, std::nano>(clock::now() - start)
+                 .count();
+}
+
+// Spins until three consecutive rate measurements are within 1% of each
+// other and returns the warmup time in milliseconds or -1 on timeout.
+int warm_up(int max_ms) {
+  using clock = std::chrono::steady_clock;
+  auto start = clock::now();
+  double prev = spin_rate();
+  int num_stable = 0;
+  for (;;) {
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                       clock::now() - start)
+                       .count();
+    if (num_stable == 2) return static_cast<int>(elapsed);
+    if (elapsed >= max_ms) return -1;
+    double rate = spin_rate();
+    num_stable = std::abs(rate - prev) <= 0.01 * prev ? num_stable + 1 : 0;
+    prev = rate;
+  }
+}
+
+// Reports the environment and returns false if it is noisy.
+bool stabilize(const options& opts) {
+  bool quiet = true;
+  auto warn = [&](const std::string& message) {
+    std::fprintf(stderr, "***WARNING*** %s\n", message.c_str());
+    quiet = false;
+  };
+
+  int cpu = opts.pin ? pin_to_cpu(opts.cpu) : -1;
+  benchmark::AddCustomContext("pinned_cpu",
+                              cpu >= 0 ? std::to_string(cpu) : "none");
+  if (opts.pin && cpu < 0) warn("failed to pin to a CPU");
+
+  if (cpu >= 0) {
+    auto governor = read_line(cpu_path(cpu, "/cpufreq/scaling_governor"));
+    if (governor.empty()) governor = "unknown";
+    benchmark::AddCustomContext("governor", governor);
+    if (governor != "performance" && governor != "unknown")
+      warn("CPU frequency governor is " + governor + ", not performance");
+
+    auto siblings = read_line(cpu_path(cpu, "/topology/thread_siblings_list"));
+    if (siblings.empty()) siblings = "unknown";
+    benchmark::AddCustomContext("smt_siblings", siblings);
+    if (siblings.find_first_of(",-") != std::string::npos)
+      warn("CPU " + std::to_string(cpu) + " shares a core with SMT siblings " +
+           siblings);
+  }
+
+  auto turbo = turbo_state();
+  benchmark::AddCustomContext("turbo", turbo);
+  if (turbo == "enabled") warn("turbo boost is enabled");
+
+  int warmup_ms = warm_up(opts.warmup_ms);
+  benchmark::AddCustomContext("warmup_ms", warmup_ms >= 0
+                                               ? std::to_string(warmup_ms)
+                                               : "unstable");
+  if (warmup_ms < 0) warn("CPU frequency did not stabilize during warmup");
+
+#ifndef _WIN32
+  double load = 0;
+  if (getloadavg(&load, 1) == 1) {
+    benchmark::AddCustomContext("load_average", std::to_string(load));
+    if (load > opts.max_load)
+      warn("load average " + std::to_string(load) + " exceeds " +
+           std::to_string(opts.max_load));
+  }
+#endif
+
+  benchmark::AddCustomContext("environment", quiet ? "quiet" : "noisy");
+  return quiet;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  auto opts = parse_options(argc, argv);
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  if (!stabilize(opts) && opts.strict) {
+    std::fprintf(stderr, "Aborting because of a noisy environment\n");
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
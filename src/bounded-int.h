@@ -0,0 +1,78 @@
+// Formatting of integers with a range known at compile time such as HTTP
+// status codes, percentages or port numbers.
+//
+// Copyright (c) 2019 - present, Victor Zverovich
+// All rights reserved.
+
+#ifndef BOUNDED_INT_H_
+#define BOUNDED_INT_H_
+
+#include <fmt/format.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#include "itoa-benchmark/itoa_swar.h"
+
+namespace bounded {
+
+constexpr int count_digits(uint32_t n) {
+  int count = 1;
+  for (; n >= 10; n /= 10) ++count;
+  return count;
+}
+
+// A table of decimal representations of all values in [0, Max], each
+// padded to 4 bytes with the last byte holding the length.
+template <uint32_t Max> struct digit_table {
+  static_assert(Max < 1000, "table is too large");
+  char entries[Max + 1][4];
+
+  constexpr digit_table() : entries() {
+    for (uint32_t value = 0; value <= Max; ++value) {
+      int size = count_digits(value);
+      uint32_t n = value;
+      for (int i = size - 1; i >= 0; --i) {
+        entries[value][i] = static_cast<char>('0' + n % 10);
+        n /= 10;
+      }
+      entries[value][3] = static_cast<char>(size);
+    }
+  }
+};
+
+template <uint32_t Max> inline constexpr digit_table<Max> table{};
+
+// Writes value in [Min, Max] in decimal to out and returns a pointer past the
+// end. The method is selected at compile time:
+// * a fixed number of digits written without branches if all values in the
+//   range have the same number of digits,
+// * a single lookup in a table of all values if Max < 1000,
+// * the SWAR conversion of up to 8 digits if Max < 100'000'000,
+// * fmt::format_int otherwise.
+// Writes up to 8 bytes so out must have room for that many characters.
+template <uint32_t Min, uint32_t Max> inline char* format(uint32_t value,
+                                                         char* out) {
+  static_assert(Min <= Max, "invalid range");
+  constexpr int num_digits = count_digits(Max);
+  if constexpr (count_digits(Min) == num_digits) {
+    for (int i = num_digits - 1; i >= 0; --i) {
+      out[i] = static_cast<char>('0' + value % 10);
+      value /= 10;
+    }
+    return out + num_digits;
+  } else if constexpr (Max < 1000) {
+    const char* entry = table<Max>.entries[value];
+    memcpy(out, entry, 4);
+    return out + entry[3];
+  } else if constexpr (Max < 100'000'000) {
+    return itoa_swar::WriteUpToEightDigits(value, out);
+  } else {
+    auto f = fmt::format_int(value);
+    memcpy(out, f.data(), f.size());
+    return out + f.size();
+  }
+}
+}  // namespace bounded
+
+#endif  // BOUNDED_INT_H_
@@ -96,5 +96,3 @@ void nullop(benchmark::State& state) {
   }
 }
 BENCHMARK(nullop);
-
-BENCHMARK_MAIN();
@@ -0,0 +1,195 @@
+// A benchmark of exporting a struct-of-arrays table with int32, int64, double
+// and short string columns to CSV row by row with one fmt::format_to call per
+// row and column by column with batch kernels followed by a gather.
+//
+// Copyright (c) 2019 - present, Victor Zverovich
+// All rights reserved.
+
+#include <benchmark/benchmark.h>
+#include <fmt/compile.h>
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+constexpr int max_columns = 16;
+
+// A table with max_columns columns of which column i has type i % 4: int32,
+// int64, double and string.
+struct table {
+  size_t num_rows;
+  std::vector<int32_t> int32_columns[max_columns / 4];
+  std::vector<int64_t> int64_columns[max_columns / 4];
+  std::vector<double> double_columns[max_columns / 4];
+  std::vector<std::string> string_columns[max_columns / 4];
+
+  explicit table(size_t n) : num_rows(n) {
+    std::mt19937_64 gen;
+    const char* words[] = {"ok", "pending", "failed", "retry", "cancelled"};
+    for (int i = 0; i < max_columns / 4; ++i) {
+      for (size_t j = 0; j < n; ++j) {
+        int32_columns[i].push_back(static_cast<int32_t>(gen() >> (gen() % 64)));
+        int64_columns[i].push_back(static_cast<int64_t>(gen()) >> (gen() % 64));
+        double_columns[i].push_back((gen() % 10'000'000) / 1000.0);
+        string_columns[i].push_back(words[gen() % 5]);
+      }
+    }
+  }
+
+  // Returns an upper bound of the CSV size with num_columns columns.
+  size_t max_size(int num_columns) const {
+    size_t size = 0;
+    for (int c = 0; c < num_columns; ++c) {
+      const size_t max_sizes[] = {11, 20, 24, 0};
+      size += num_rows * (max_sizes[c % 4] + 1);
+      if (c % 4 == 3) {
+        for (const auto& s : string_columns[c / 4]) size += s.size();
+      }
+    }
+    return size;
+  }
+};
+
+const table& get_table(size_t num_rows) {
+  static std::map<size_t, std::unique_ptr<table>> tables;
+  auto& t = tables[num_rows];
+  if (!t) t = std::make_unique<table>(num_rows);
+  return *t;
+}
+
+// Returns the value in row r of column C.
+template <int C> auto get(const table& t, size_t r) {
+  if constexpr (C % 4 == 0) return t.int32_columns[C / 4][r];
+  if constexpr (C % 4 == 1) return t.int64_columns[C / 4][r];
+  if constexpr (C % 4 == 2) return t.double_columns[C / 4][r];
+  if constexpr (C % 4 == 3) return fmt::string_view(t.string_columns[C / 4][r]);
+}
+
+template <int... C>
+char* format_row(char* out, const table& t, size_t r, fmt::string_view format,
+                 std::integer_sequence<int, C...>) {
+  return fmt::format_to(out, fmt::runtime(format), get<C>(t, r)...);
+}
+
+// Formats the table with one fmt::format_to call per row.
+template <int NumColumns> char* format_row_major(char* out, const table& t) {
+  std::string format;
+  for (int c = 0; c < NumColumns; ++c) format += c == 0 ? "{}" : ",{}";
+  format += '\n';
+  for (size_t r = 0; r < t.num_rows; ++r) {
+    out = format_row(out, t, r, format,
+                     std::make_integer_sequence<int, NumColumns>());
+  }
+  return out;
+}
+
+// A column formatted into a contiguous buffer with cell c at
+// [data + ends[c - 1], data + ends[c]).
+struct formatted_column {
+  std::unique_ptr<char[]> data;
+  std::vector<uint32_t> ends;
+};
+
+// Formats values of a single type in a tight loop.
+template <typename T>
+void format_column(formatted_column& column, const std::vector<T>& values) {
+  char* out = column.data.get();
+  for (size_t i = 0; i < values.size(); ++i) {
+    if constexpr (std::is_same<T, std::string>::value) {
+      std::memcpy(out, values[i].data(), values[i].size());
+      out += values[i].size();
+    } else {
+      out = fmt::format_to(out, FMT_COMPILE("{}"), values[i]);
+    }
+    column.ends[i + 1] = static_cast<uint32_t>(out - column.data.get());
+  }
+}
+
+// Formats each column into its own buffer and then interleaves the cells
+// with separators.
+char* format_column_major(char* out, const table& t,
+                          std::vector<formatted_column>& columns) {
+  int num_columns = static_cast<int>(columns.size());
+  for (int c = 0; c < num_columns; ++c) {
+    switch (c % 4) {
+    case 0:
+      format_column(columns[c], t.int32_columns[c / 4]);
+      break;
+    case 1:
+      format_column(columns[c], t.int64_columns[c / 4]);
+      break;
+    case 2:
+      format_column(columns[c], t.double_columns[c / 4]);
+      break;
+    case 3:
+      format_column(columns[c], t.string_columns[c / 4]);
+      break;
+    }
+  }
+  for (size_t r = 0; r < t.num_rows; ++r) {
+    for (const auto& column : columns) {
+      uint32_t begin = column.ends[r], size = column.ends[r + 1] - begin;
+      std::memcpy(out, column.data.get() + begin, size);
+      out += size;
+      *out++ = ',';
+    }
+    out[-1] = '\n';
+  }
+  return out;
+}
+
+template <int NumColumns> void row_major(benchmark::State& state) {
+  const auto& t = get_table(static_cast<size_t>(state.range(0)));
+  size_t max_size = t.max_size(NumColumns);
+  auto out = std::unique_ptr<char[]>(new char[max_size]);
+  size_t size = 0;
+  for (auto s : state) {
+    size = format_row_major<NumColumns>(out.get(), t) - out.get();
+    benchmark::DoNotOptimize(out.get());
+  }
+  state.SetItemsProcessed(state.iterations() * t.num_rows);
+  state.SetBytesProcessed(state.iterations() * size);
+}
+
+template <int NumColumns> void column_major(benchmark::State& state) {
+  const auto& t = get_table(static_cast<size_t>(state.range(0)));
+  size_t max_size = t.max_size(NumColumns);
+  auto out = std::unique_ptr<char[]>(new char[max_size]);
+  std::vector<formatted_column> columns(NumColumns);
+  for (int c = 0; c < NumColumns; ++c) {
+    columns[c].data.reset(new char[t.max_size(c + 1) - t.max_size(c)]);
+    columns[c].ends.resize(t.num_rows + 1);
+  }
+  size_t size = 0;
+  for (auto s : state) {
+    size = format_column_major(out.get(), t, columns) - out.get();
+    benchmark::DoNotOptimize(out.get());
+  }
+  // Check that both methods give the same output.
+  auto expected = std::unique_ptr<char[]>(new char[max_size]);
+  size_t expected_size =
+      format_row_major<NumColumns>(expected.get(), t) - expected.get();
+  if (size != expected_size ||
+      std::memcmp(out.get(), expected.get(), size) != 0) {
+    throw std::logic_error("invalid output");
+  }
+  state.SetItemsProcessed(state.iterations() * t.num_rows);
+  state.SetBytesProcessed(state.iterations() * size);
+}
+
+void row_args(benchmark::internal::Benchmark* b) {
+  b->ArgName("rows")->RangeMultiplier(16)->Range(1 << 10, 1 << 18);
+}
+
+BENCHMARK_TEMPLATE(row_major, 4)->Apply(row_args);
+BENCHMARK_TEMPLATE(column_major, 4)->Apply(row_args);
+BENCHMARK_TEMPLATE(row_major, 8)->Apply(row_args);
+BENCHMARK_TEMPLATE(column_major, 8)->Apply(row_args);
+BENCHMARK_TEMPLATE(row_major, 16)->Apply(row_args);
+BENCHMARK_TEMPLATE(column_major, 16)->Apply(row_args);
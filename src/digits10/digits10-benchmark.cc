@@ -41,5 +41,3 @@ BENCHMARK(unroll4)->Apply(num_digits);
 
 static void clz(benchmark::State& state) { run_benchmark(state, digits10_clz); }
 BENCHMARK(clz)->Apply(num_digits);
-
-BENCHMARK_MAIN();
@@ -0,0 +1,234 @@
+// A benchmark of left-aligning UTF-8 strings in a field as with "{:<W}" for
+// ASCII, Latin-1-range, CJK and emoji strings of different lengths. Display
+// width is computed by fmt, by a two-stage table and by an SSE2 ASCII fast
+// path falling back to the table, and compared to padding by the byte length
+// which is only correct for ASCII.
+//
+// Copyright (c) 2019 - present, Victor Zverovich
+// All rights reserved.
+
+#include <benchmark/benchmark.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#  include <immintrin.h>
+#  define HAVE_SIMD
+#endif
+
+enum input_kind { ascii, latin1, cjk, emoji };
+
+void append_utf8(std::string& s, uint32_t cp) {
+  if (cp < 0x80) {
+    s += static_cast<char>(cp);
+  } else if (cp < 0x800) {
+    s += static_cast<char>(0xc0 | (cp >> 6));
+    s += static_cast<char>(0x80 | (cp & 0x3f));
+  } else if (cp < 0x10000) {
+    s += static_cast<char>(0xe0 | (cp >> 12));
+    s += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+    s += static_cast<char>(0x80 | (cp & 0x3f));
+  } else {
+    s += static_cast<char>(0xf0 | (cp >> 18));
+    s += static_cast<char>(0x80 | ((cp >> 12) & 0x3f));
+    s += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+    s += static_cast<char>(0x80 | (cp & 0x3f));
+  }
+}
+
+// Returns 1024 strings of the given kind with length code points. Latin-1
+// and emoji strings are words with every 4th code point from the range.
+const std::vector<std::string>& get_input(input_kind kind, size_t length) {
+  static std::map<std::pair<input_kind, size_t>, std::vector<std::string>>
+      inputs;
+  auto& input = inputs[{kind, length}];
+  if (!input.empty()) return input;
+  std::mt19937 gen;
+  input.resize(1024);
+  for (auto& s : input) {
+    for (size_t i = 0; i < length; ++i) {
+      uint32_t cp = "abcdefghijklmnopqrstuvwxyz "[gen() % 27];
+      switch (kind) {
+      case ascii:
+        break;
+      case latin1:
+        if (gen() % 4 == 0) cp = 0xc0 + gen() % 0x40;
+        break;
+      case cjk:
+        cp = 0x4e00 + gen() % 0x5200;
+        break;
+      case emoji:
+        if (gen() % 4 == 0) cp = 0x1f600 + gen() % 0x50;
+        break;
+      }
+      append_utf8(s, cp);
+    }
+  }
+  return input;
+}
+
+// Ranges of code points that fmt treats as two columns wide.
+constexpr std::pair<uint32_t, uint32_t> wide_ranges[] = {
+    {0x1100, 0x115f},   {0x2329, 0x232a},   {0x2e80, 0x303e},
+    {0x3040, 0xa4cf},   {0xac00, 0xd7a3},   {0xf900, 0xfaff},
+    {0xfe10, 0xfe19},   {0xfe30, 0xfe6f},   {0xff00, 0xff60},
+    {0xffe0, 0xffe6},   {0x1f300, 0x1f64f}, {0x1f900, 0x1f9ff},
+    {0x20000, 0x2fffd}, {0x30000, 0x3fffd}};
+
+// A two-stage table of code point widths: the first stage maps the upper
+// bits of a code point to a block of 256 widths. Identical blocks are shared
+// so there are only a few distinct ones.
+class width_table {
+ private:
+  std::vector<uint8_t> block_indices_;
+  std::vector<uint8_t> blocks_;
+
+ public:
+  width_table() : block_indices_(0x110000 >> 8) {
+    std::vector<uint8_t> cp_widths(0x110000, 1);
+    for (auto r : wide_ranges) {
+      for (uint32_t cp = r.first; cp <= r.second; ++cp) cp_widths[cp] = 2;
+    }
+    std::map<std::vector<uint8_t>, uint8_t> block_map;
+    for (size_t i = 0; i < block_indices_.size(); ++i) {
+      auto begin = cp_widths.begin() + i * 256;
+      auto result = block_map.emplace(std::vector<uint8_t>(begin, begin + 256),
+                                      block_map.size());
+      if (result.second) blocks_.insert(blocks_.end(), begin, begin + 256);
+      block_indices_[i] = result.first->second;
+    }
+  }
+
+  size_t width(uint32_t cp) const {
+    return blocks_[block_indices_[cp >> 8] * 256 + (cp & 0xff)];
+  }
+};
+
+const width_table widths;
+
+// Returns the display width of a valid UTF-8 string decoding every code point
+// and looking up its width in the table.
+size_t compute_width_table(const char* p, const char* end) {
+  size_t width = 0;
+  while (p != end) {
+    auto c = static_cast<unsigned char>(*p);
+    if (c < 0x80) {
+      ++width;
+      ++p;
+      continue;
+    }
+    uint32_t cp;
+    if (c < 0xe0) {
+      cp = ((c & 0x1f) << 6) | (p[1] & 0x3f);
+      p += 2;
+    } else if (c < 0xf0) {
+      cp = ((c & 0x0f) << 12) | ((p[1] & 0x3f) << 6) | (p[2] & 0x3f);
+      p += 3;
+    } else {
+      cp = ((c & 0x07) << 18) | ((p[1] & 0x3f) << 12) | ((p[2] & 0x3f) << 6) |
+           (p[3] & 0x3f);
+      p += 4;
+    }
+    width += widths.width(cp);
+  }
+  return width;
+}
+
+#ifdef HAVE_SIMD
+// Skips 16-byte blocks of ASCII characters whose width is one per byte and
+// computes the width of the rest with the table.
+size_t compute_width_simd(const char* p, const char* end) {
+  const char* begin = p;
+  while (end - p >= 16) {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    if (_mm_movemask_epi8(bytes) != 0) break;
+    p += 16;
+  }
+  return static_cast<size_t>(p - begin) + compute_width_table(p, end);
+}
+#endif
+
+// Left-aligns s in a field of the given width.
+template <size_t (*compute_width)(const char*, const char*)>
+char* align_left(char* out, fmt::string_view s, size_t width) {
+  std::memcpy(out, s.data(), s.size());
+  out += s.size();
+  size_t w = compute_width(s.data(), s.data() + s.size());
+  if (w >= width) return out;
+  std::memset(out, ' ', width - w);
+  return out + width - w;
+}
+
+size_t byte_length(const char* begin, const char* end) { return end - begin; }
+
+// The field width is twice the length in code points so that all strings
+// except CJK ones are padded. Byte length alignment is only correct for ASCII
+// so only the output size is checked for other strings if exact is false.
+template <typename F>
+void run(benchmark::State& state, F align, bool exact = true) {
+  auto kind = static_cast<input_kind>(state.range(0));
+  auto length = static_cast<size_t>(state.range(1));
+  const auto& input = get_input(kind, length);
+  size_t width = length * 2;
+  auto buffer = std::unique_ptr<char[]>(new char[length * 4 + width]);
+  size_t size = 0;
+  for (auto s : state) {
+    for (const auto& str : input) {
+      size += align(buffer.get(), str, width) - buffer.get();
+      benchmark::DoNotOptimize(buffer.get());
+    }
+  }
+  // Check the padding against fmt.
+  for (const auto& str : input) {
+    auto end = align(buffer.get(), str, width);
+    auto actual = fmt::string_view(buffer.get(), end - buffer.get());
+    if (!exact && kind != ascii) {
+      if (actual.size() != std::max(str.size(), width))
+        throw std::logic_error("invalid output");
+    } else if (actual != fmt::format("{:<{}}", str, width)) {
+      throw std::logic_error("invalid output");
+    }
+  }
+  state.SetBytesProcessed(size);
+  state.SetItemsProcessed(state.iterations() * input.size());
+}
+
+void width_args(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"kind", "length"})
+      ->ArgsProduct({benchmark::CreateDenseRange(ascii, emoji, 1),
+                     benchmark::CreateRange(4, 256, 4)});
+}
+
+void fmt_format_to(benchmark::State& state) {
+  run(state, [](char* out, fmt::string_view s, size_t width) {
+    return fmt::format_to(out, "{:<{}}", s, width);
+  });
+}
+BENCHMARK(fmt_format_to)->Apply(width_args);
+
+void byte_length_align(benchmark::State& state) {
+  run(state, align_left<byte_length>, false);
+}
+BENCHMARK(byte_length_align)->Apply(width_args);
+
+void table(benchmark::State& state) {
+  run(state, align_left<compute_width_table>);
+}
+BENCHMARK(table)->Apply(width_args);
+
+#ifdef HAVE_SIMD
+void simd_ascii(benchmark::State& state) {
+  run(state, align_left<compute_width_simd>);
+}
+BENCHMARK(simd_ascii)->Apply(width_args);
+#endif
@@ -0,0 +1,233 @@
+// A benchmark of escaping strings as with the debug format specifier "{:?}"
+// for plain ASCII, mostly ASCII with quotes and control characters and UTF-8
+// heavy strings of different lengths. The SIMD methods find the next byte
+// that may need escaping and copy the safe run before it at once. Comparing
+// them with the naive loop across lengths gives the break-even length.
+//
+// Copyright (c) 2019 - present, Victor Zverovich
+// All rights reserved.
+
+#include <benchmark/benchmark.h>
+#include <fmt/format.h>
+
+#include <cstring>
+#include <map>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "hex.h"
+
+enum input_kind { ascii, quotes, utf8 };
+
+// Returns strings of the given kind and length, 64 KiB in total.
+const std::vector<std::string>& get_input(input_kind kind, size_t length) {
+  static std::map<std::pair<input_kind, size_t>, std::vector<std::string>>
+      inputs;
+  auto& input = inputs[{kind, length}];
+  if (!input.empty()) return input;
+  std::mt19937 gen;
+  const char* specials[] = {"\"", "\\", "\n", "\t", "\x01"};
+  // Printable code points that "{:?}" doesn't escape.
+  const char* code_points[] = {"é", "ü", "ß", "Ж",
+                               "中", "文", "字", "\U0001f600"};
+  input.resize((64 << 10) / length + 1);
+  for (auto& s : input) {
+    while (s.size() < length) {
+      std::string c(1, "abcdefghijklmnopqrstuvwxyz0123456789 "[gen() % 37]);
+      if (kind == quotes && gen() % 16 == 0) c = specials[gen() % 5];
+      if (kind == utf8 && gen() % 2 == 0) c = code_points[gen() % 8];
+      if (s.size() + c.size() > length) c = "a";
+      s += c;
+    }
+  }
+  return input;
+}
+
+// Escapes the character at p that needs escaping or starts a multibyte
+// UTF-8 sequence which is copied as is. Returns a pointer past the end of the
+// output and advances p.
+inline char* escape_char(char* out, const char*& p) {
+  auto c = static_cast<unsigned char>(*p++);
+  if (c >= 0x80) {
+    size_t size = c >= 0xf0 ? 4 : c >= 0xe0 ? 3 : 2;
+    std::memcpy(out, p - 1, size);
+    p += size - 1;
+    return out + size;
+  }
+  *out++ = '\\';
+  switch (c) {
+  case '"':
+  case '\\':
+    *out++ = static_cast<char>(c);
+    return out;
+  case '\n':
+    *out++ = 'n';
+    return out;
+  case '\r':
+    *out++ = 'r';
+    return out;
+  case '\t':
+    *out++ = 't';
+    return out;
+  }
+  *out++ = 'x';
+  std::memcpy(out, hex_digits.entries[c], 2);
+  return out + 2;
+}
+
+inline bool is_safe(unsigned char c) {
+  return c >= 0x20 && c < 0x7f && c != '"' && c != '\\';
+}
+
+// Escapes s writing up to 4 * s.size() + 2 characters.
+char* escape_naive(char* out, fmt::string_view s) {
+  *out++ = '"';
+  const char* p = s.data();
+  const char* end = p + s.size();
+  while (p != end) {
+    if (is_safe(static_cast<unsigned char>(*p)))
+      *out++ = *p++;
+    else
+      out = escape_char(out, p);
+  }
+  *out++ = '"';
+  return out;
+}
+
+#ifdef HAVE_SIMD
+// Returns a mask of bytes that are not safe: control characters and non-ASCII
+// bytes (which are negative as signed), DEL, quotes and backslashes.
+inline unsigned unsafe_mask(__m128i bytes) {
+  __m128i unsafe = _mm_or_si128(
+      _mm_or_si128(_mm_cmplt_epi8(bytes, _mm_set1_epi8(0x20)),
+                   _mm_cmpeq_epi8(bytes, _mm_set1_epi8(0x7f))),
+      _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('"')),
+                   _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\\'))));
+  return static_cast<unsigned>(_mm_movemask_epi8(unsafe));
+}
+
+// Escapes s 16 bytes at a time storing the whole block and advancing the
+// output by the length of the safe run. Requires 16 bytes of padding in the
+// output.
+char* escape_sse2(char* out, fmt::string_view s) {
+  *out++ = '"';
+  const char* p = s.data();
+  const char* end = p + s.size();
+  while (end - p >= 16) {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), bytes);
+    unsigned mask = unsafe_mask(bytes);
+    if (mask == 0) {
+      out += 16;
+      p += 16;
+      continue;
+    }
+    int n = __builtin_ctz(mask);
+    out += n;
+    p += n;
+    out = escape_char(out, p);
+  }
+  while (p < end) {
+    if (is_safe(static_cast<unsigned char>(*p)))
+      *out++ = *p++;
+    else
+      out = escape_char(out, p);
+  }
+  *out++ = '"';
+  return out;
+}
+
+// The same as escape_sse2 but with 32-byte blocks. Requires 32 bytes of
+// padding in the output. The caller must check that AVX2 is supported.
+__attribute__((target("avx2"))) char* escape_avx2(char* out,
+                                                  fmt::string_view s) {
+  *out++ = '"';
+  const char* p = s.data();
+  const char* end = p + s.size();
+  while (end - p >= 32) {
+    __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), bytes);
+    __m256i unsafe = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(0x20), bytes),
+                        _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(0x7f))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('"')),
+                        _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\\'))));
+    auto mask = static_cast<unsigned>(_mm256_movemask_epi8(unsafe));
+    if (mask == 0) {
+      out += 32;
+      p += 32;
+      continue;
+    }
+    int n = __builtin_ctz(mask);
+    out += n;
+    p += n;
+    out = escape_char(out, p);
+  }
+  while (p < end) {
+    if (is_safe(static_cast<unsigned char>(*p)))
+      *out++ = *p++;
+    else
+      out = escape_char(out, p);
+  }
+  *out++ = '"';
+  return out;
+}
+#endif
+
+template <typename F> void run(benchmark::State& state, F escape) {
+  const auto& input = get_input(static_cast<input_kind>(state.range(0)),
+                                static_cast<size_t>(state.range(1)));
+  size_t input_size = 0;
+  for (const auto& s : input) input_size += s.size();
+  auto buffer = std::unique_ptr<char[]>(new char[state.range(1) * 4 + 34]);
+  for (auto s : state) {
+    for (const auto& str : input) {
+      escape(buffer.get(), str);
+      benchmark::DoNotOptimize(buffer.get());
+    }
+  }
+  // Check the output against "{:?}".
+  for (const auto& str : input) {
+    auto expected = fmt::format("{:?}", str);
+    if (fmt::string_view(buffer.get(), escape(buffer.get(), str) -
+                                           buffer.get()) != expected) {
+      throw std::logic_error("invalid output");
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * input_size);
+  state.SetItemsProcessed(state.iterations() * input.size());
+}
+
+void escape_args(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"kind", "length"})
+      ->ArgsProduct({benchmark::CreateDenseRange(ascii, utf8, 1),
+                     benchmark::CreateRange(4, 1 << 16, 2)});
+}
+
+void fmt_debug(benchmark::State& state) {
+  run(state, [](char* out, fmt::string_view s) {
+    return fmt::format_to(out, "{:?}", s);
+  });
+}
+BENCHMARK(fmt_debug)->Apply(escape_args);
+
+void naive(benchmark::State& state) { run(state, escape_naive); }
+BENCHMARK(naive)->Apply(escape_args);
+
+#ifdef HAVE_SIMD
+void sse2(benchmark::State& state) { run(state, escape_sse2); }
+BENCHMARK(sse2)->Apply(escape_args);
+
+void avx2(benchmark::State& state) {
+  if (!__builtin_cpu_supports("avx2")) {
+    state.SkipWithError("AVX2 is not supported");
+    return;
+  }
+  run(state, escape_avx2);
+}
+BENCHMARK(avx2)->Apply(escape_args);
+#endif
@@ -59,5 +59,3 @@ BENCHMARK(fmt_print_runtime)->RangeMultiplier(2)->Range(BUFSIZ, 1 << 20);
   }
 }
 BENCHMARK(fmt_print_compile_default);*/
-
-BENCHMARK_MAIN();
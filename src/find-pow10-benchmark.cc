@@ -48,5 +48,3 @@ void find_pow10_int(benchmark::State &s) {
   benchmark::DoNotOptimize(result);
 }
 BENCHMARK(find_pow10_int);
-
-BENCHMARK_MAIN();
@@ -0,0 +1,162 @@
+// A benchmark of formatting fixed-point decimals stored as int64_t with an
+// implied scale, e.g. 12345 with scale 2 is 123.45.
+//
+// Copyright (c) 2019 - present, Victor Zverovich
+// All rights reserved.
+
+#include <benchmark/benchmark.h>
+#include <fmt/format.h>
+
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "digits10/digits10.h"
+#include "itoa-benchmark/digitslut.h"
+
+constexpr int min_scale = 2, max_scale = 9;
+
+constexpr uint64_t scale_factors[] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+struct Data {
+  std::vector<int64_t> values;
+
+  // Values of both signs with 1 to 13 digits.
+  Data() : values(1'000'000) {
+    std::mt19937_64 gen;
+    for (auto& value : values) {
+      auto shift = gen() % 40;
+      auto magnitude = static_cast<int64_t>((gen() >> 24) >> shift);
+      value = gen() % 2 ? -magnitude : magnitude;
+    }
+  }
+} data;
+
+// The commonly used pattern of splitting the value into the integer and
+// fractional parts and formatting them separately. It is also the reference
+// for the verification of the kernel.
+char* format_split(char* out, int64_t value, int scale) {
+  uint64_t abs_value = static_cast<uint64_t>(value);
+  if (value < 0) abs_value = 0 - abs_value;
+  uint64_t factor = scale_factors[scale];
+  return fmt::format_to(out, "{}{}.{:0{}}", value < 0 ? "-" : "",
+                        abs_value / factor, abs_value % factor, scale);
+}
+
+// Writes the value in a single right-to-left pass using the two-digit table
+// from branchlut: the fraction with exactly scale digits which gives zero
+// padding for free, the dot and the integer part. The total size is computed
+// upfront with digits10_fmt64.
+char* format_fixed(char* out, int64_t value, int scale) {
+  uint64_t abs_value = static_cast<uint64_t>(value);
+  if (value < 0) {
+    *out++ = '-';
+    abs_value = 0 - abs_value;
+  }
+  uint64_t int_part = abs_value / scale_factors[scale];
+  uint64_t frac_part = abs_value % scale_factors[scale];
+  char* end = out + digits10_fmt64(int_part) + 1 + scale;
+  char* p = end;
+  for (int i = scale; i >= 2; i -= 2) {
+    unsigned d = static_cast<unsigned>(frac_part % 100) * 2;
+    frac_part /= 100;
+    *--p = gDigitsLut[d + 1];
+    *--p = gDigitsLut[d];
+  }
+  if (scale % 2 != 0) *--p = static_cast<char>('0' + frac_part);
+  *--p = '.';
+  while (int_part >= 100) {
+    unsigned d = static_cast<unsigned>(int_part % 100) * 2;
+    int_part /= 100;
+    *--p = gDigitsLut[d + 1];
+    *--p = gDigitsLut[d];
+  }
+  if (int_part >= 10) {
+    unsigned d = static_cast<unsigned>(int_part) * 2;
+    *--p = gDigitsLut[d + 1];
+    *--p = gDigitsLut[d];
+  } else {
+    *--p = static_cast<char>('0' + int_part);
+  }
+  assert(p == out);
+  return end;
+}
+
+void scale_args(benchmark::internal::Benchmark* b) {
+  b->ArgName("scale")->DenseRange(min_scale, max_scale);
+}
+
+template <typename F> void run(benchmark::State& state, F format) {
+  int scale = static_cast<int>(state.range(0));
+  size_t size = 0;
+  for (auto s : state) {
+    for (auto value : data.values) {
+      char buffer[32];
+      size += format(buffer, value, scale) - buffer;
+      benchmark::DoNotOptimize(buffer);
+    }
+  }
+  benchmark::DoNotOptimize(size);
+  state.SetItemsProcessed(state.iterations() * data.values.size());
+}
+
+void fmt_format_split(benchmark::State& state) {
+  int scale = static_cast<int>(state.range(0));
+  size_t size = 0;
+  for (auto s : state) {
+    for (auto value : data.values) {
+      uint64_t abs_value = static_cast<uint64_t>(value);
+      if (value < 0) abs_value = 0 - abs_value;
+      std::string str = fmt::format("{}{}.{:0{}}", value < 0 ? "-" : "",
+                                    abs_value / scale_factors[scale],
+                                    abs_value % scale_factors[scale], scale);
+      size += str.size();
+    }
+  }
+  benchmark::DoNotOptimize(size);
+  state.SetItemsProcessed(state.iterations() * data.values.size());
+}
+BENCHMARK(fmt_format_split)->Apply(scale_args);
+
+void fmt_format_to_split(benchmark::State& state) {
+  run(state, format_split);
+}
+BENCHMARK(fmt_format_to_split)->Apply(scale_args);
+
+// Formatting via double is shown for comparison only. It is not exact for
+// values that exceed the double precision.
+void fmt_format_to_double(benchmark::State& state) {
+  run(state, [](char* out, int64_t value, int scale) {
+    return fmt::format_to(
+        out, "{:.{}f}", static_cast<double>(value) / scale_factors[scale],
+        scale);
+  });
+}
+BENCHMARK(fmt_format_to_double)->Apply(scale_args);
+
+void snprintf_double(benchmark::State& state) {
+  run(state, [](char* out, int64_t value, int scale) {
+    double d = static_cast<double>(value) / scale_factors[scale];
+    return out + std::snprintf(out, 32, "%.*f", scale, d);
+  });
+}
+BENCHMARK(snprintf_double)->Apply(scale_args);
+
+void fixed_point_kernel(benchmark::State& state) {
+  int scale = static_cast<int>(state.range(0));
+  for (auto value : data.values) {
+    char expected[32], actual[32];
+    auto expected_end = format_split(expected, value, scale);
+    auto actual_end = format_fixed(actual, value, scale);
+    if (std::string(expected, expected_end) != std::string(actual, actual_end))
+      throw std::logic_error("invalid output");
+  }
+  run(state, format_fixed);
+}
+BENCHMARK(fixed_point_kernel)->Apply(scale_args);
@@ -0,0 +1,292 @@
+// A benchmark of formatting byte buffers such as packet payloads in hex:
+// plain ("0a1b2c"), with separators ("0a 1b 2c") and as lines of 16 bytes
+// with offsets ("00000010: 0a 1b 2c ...\n"). Throughput is reported in input
+// bytes per second to compare with the memory bandwidth.
+//
+// Copyright (c) 2019 - present, Victor Zverovich
+// All rights reserved.
+
+#include <benchmark/benchmark.h>
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "hex.h"
+
+enum mode { plain, spaced, offset };
+
+constexpr size_t line_size = 16;
+
+const std::vector<uint8_t>& get_data() {
+  static auto data = [] {
+    std::vector<uint8_t> data(1 << 20);
+    std::mt19937 gen;
+    for (auto& byte : data) byte = static_cast<uint8_t>(gen());
+    return data;
+  }();
+  return data;
+}
+
+// Returns the size of the output for size bytes in mode m.
+size_t output_size(size_t size, mode m) {
+  switch (m) {
+  case plain:
+    return size * 2;
+  case spaced:
+    return size * 3 - 1;
+  case offset:
+    break;
+  }
+  size_t num_lines = (size + line_size - 1) / line_size;
+  // "00000010: " and a newline in place of the last separator.
+  return size * 3 + num_lines * 10;
+}
+
+// Returns the output of the snprintf loop which is the reference.
+const std::string& get_expected(size_t size, mode m) {
+  static std::map<std::pair<size_t, mode>, std::string> cache;
+  auto& expected = cache[{size, m}];
+  if (!expected.empty()) return expected;
+  const uint8_t* data = get_data().data();
+  expected.resize(output_size(size, m) + 1);
+  char* p = &expected[0];
+  for (size_t i = 0; i < size; i += line_size) {
+    if (m == offset) p += std::snprintf(p, 10, "%08zx:", i);
+    for (size_t j = i; j < i + line_size && j < size; ++j) {
+      bool first = m == plain || (m == spaced && j == 0);
+      p += std::snprintf(p, 4, first ? "%02x" : " %02x", data[j]);
+    }
+    if (m == offset) *p++ = '\n';
+  }
+  expected.resize(p - expected.data());
+  return expected;
+}
+
+template <typename F> void run(benchmark::State& state, F format) {
+  auto size = static_cast<size_t>(state.range(0));
+  auto m = static_cast<mode>(state.range(1));
+  const uint8_t* data = get_data().data();
+  // Extra room for the SIMD stores past the end.
+  auto out = std::unique_ptr<char[]>(new char[output_size(size, m) + 64]);
+  size_t out_size = 0;
+  for (auto s : state) {
+    out_size = format(data, size, out.get(), m) - out.get();
+    benchmark::DoNotOptimize(out.get());
+  }
+  if (get_expected(size, m) != std::string(out.get(), out_size))
+    throw std::logic_error("invalid output");
+  state.SetBytesProcessed(state.iterations() * size);
+}
+
+void dump_args(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"size", "mode"})
+      ->ArgsProduct({benchmark::CreateRange(16, 1 << 20, 16),
+                     {plain, spaced, offset}});
+}
+
+void fmt_join(benchmark::State& state) {
+  run(state, [](const uint8_t* data, size_t size, char* out, mode m) {
+    switch (m) {
+    case plain:
+      return fmt::format_to(out, "{:02x}", fmt::join(data, data + size, ""));
+    case spaced:
+      return fmt::format_to(out, "{:02x}", fmt::join(data, data + size, " "));
+    case offset:
+      break;
+    }
+    for (size_t i = 0; i < size; i += line_size) {
+      const uint8_t* end = data + (std::min)(size, i + line_size);
+      out = fmt::format_to(out, "{:08x}: {:02x}\n", i,
+                           fmt::join(data + i, end, " "));
+    }
+    return out;
+  });
+}
+BENCHMARK(fmt_join)->Apply(dump_args);
+
+void snprintf_loop(benchmark::State& state) {
+  run(state, [](const uint8_t* data, size_t size, char* out, mode m) {
+    for (size_t i = 0; i < size; i += line_size) {
+      if (m == offset) out += std::snprintf(out, 10, "%08zx:", i);
+      for (size_t j = i; j < i + line_size && j < size; ++j) {
+        bool first = m == plain || (m == spaced && j == 0);
+        out += std::snprintf(out, 4, first ? "%02x" : " %02x", data[j]);
+      }
+      if (m == offset) *out++ = '\n';
+    }
+    return out;
+  });
+}
+BENCHMARK(snprintf_loop)->Apply(dump_args);
+
+// Writes up to 16 bytes each followed by a space.
+inline char* write_spaced(const uint8_t* data, size_t size, char* out) {
+  for (size_t i = 0; i < size; ++i) {
+    std::memcpy(out, hex_digits.entries[data[i]], 2);
+    out[2] = ' ';
+    out += 3;
+  }
+  return out;
+}
+
+// Writes data in lines of 16 bytes with offsets using write_line to write a
+// line of bytes each followed by a space. The last space is replaced with a
+// newline.
+template <typename F>
+char* write_lines(const uint8_t* data, size_t size, char* out, F write_line) {
+  for (size_t i = 0; i < size; i += line_size) {
+    auto off = static_cast<uint32_t>(i);
+    std::memcpy(out, hex_digits.entries[off >> 24], 2);
+    std::memcpy(out + 2, hex_digits.entries[(off >> 16) & 0xff], 2);
+    std::memcpy(out + 4, hex_digits.entries[(off >> 8) & 0xff], 2);
+    std::memcpy(out + 6, hex_digits.entries[off & 0xff], 2);
+    out[8] = ':';
+    out[9] = ' ';
+    out = write_line(data + i, (std::min)(line_size, size - i), out + 10);
+    out[-1] = '\n';
+  }
+  return out;
+}
+
+char* format_lut(const uint8_t* data, size_t size, char* out, mode m) {
+  switch (m) {
+  case plain:
+    for (size_t i = 0; i < size; ++i, out += 2)
+      std::memcpy(out, hex_digits.entries[data[i]], 2);
+    return out;
+  case spaced:
+    return write_spaced(data, size, out) - 1;
+  case offset:
+    break;
+  }
+  return write_lines(data, size, out, write_spaced);
+}
+
+void lut(benchmark::State& state) { run(state, format_lut); }
+BENCHMARK(lut)->Apply(dump_args);
+
+#ifdef HAVE_SIMD
+// pshufb indices that spread the 32 digits of 16 bytes into 48 characters
+// with a space after each byte. The output chunk k takes digits from lo with
+// indices[k][0] and from hi with indices[k][1]; -1 gives a zero byte.
+struct spread_table {
+  int8_t indices[3][2][16];
+  int8_t spaces[3][16];
+
+  constexpr spread_table() : indices(), spaces() {
+    for (int i = 0; i < 48; ++i) {
+      int chunk = i / 16, pos = i % 16, digit = i / 3 * 2 + i % 3;
+      bool is_space = i % 3 == 2;
+      spaces[chunk][pos] = is_space ? ' ' : 0;
+      indices[chunk][0][pos] = !is_space && digit < 16 ? digit : -1;
+      indices[chunk][1][pos] = !is_space && digit >= 16 ? digit - 16 : -1;
+    }
+  }
+};
+
+alignas(16) inline constexpr spread_table spread{};
+
+__attribute__((target("ssse3"))) char* write_spaced_ssse3(const uint8_t* data,
+                                                          size_t size,
+                                                          char* out) {
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16, out += 48) {
+    __m128i lo, hi;
+    encode16(data + i, lo, hi);
+    for (int k = 0; k < 3; ++k) {
+      auto load = [](const int8_t* p) {
+        return _mm_load_si128(reinterpret_cast<const __m128i*>(p));
+      };
+      __m128i chunk = _mm_or_si128(
+          _mm_or_si128(_mm_shuffle_epi8(lo, load(spread.indices[k][0])),
+                       _mm_shuffle_epi8(hi, load(spread.indices[k][1]))),
+          load(spread.spaces[k]));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + k * 16), chunk);
+    }
+  }
+  return write_spaced(data + i, size - i, out);
+}
+
+__attribute__((target("ssse3"))) char* format_ssse3(const uint8_t* data,
+                                                    size_t size, char* out,
+                                                    mode m) {
+  switch (m) {
+  case plain: {
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16, out += 32) {
+      __m128i lo, hi;
+      encode16(data + i, lo, hi);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out), lo);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), hi);
+    }
+    return format_lut(data + i, size - i, out, plain);
+  }
+  case spaced:
+    return write_spaced_ssse3(data, size, out) - 1;
+  case offset:
+    break;
+  }
+  return write_lines(data, size, out, write_spaced_ssse3);
+}
+
+void ssse3(benchmark::State& state) {
+  if (!__builtin_cpu_supports("ssse3")) {
+    state.SkipWithError("SSSE3 is not supported");
+    return;
+  }
+  run(state, format_ssse3);
+}
+BENCHMARK(ssse3)->Apply(dump_args);
+
+// Encodes 32 bytes per iteration in the plain mode. The lines with offsets
+// and separators are 16 bytes long so the other modes use SSSE3.
+__attribute__((target("avx2"))) char* format_avx2(const uint8_t* data,
+                                                  size_t size, char* out,
+                                                  mode m) {
+  if (m != plain) return format_ssse3(data, size, out, m);
+  const __m256i digits = _mm256_setr_epi8(
+      '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e',
+      'f', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd',
+      'e', 'f');
+  const __m256i mask = _mm256_set1_epi8(0xf);
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32, out += 64) {
+    __m256i bytes =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    __m256i high_nibbles = _mm256_shuffle_epi8(
+        digits, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), mask));
+    __m256i low_nibbles =
+        _mm256_shuffle_epi8(digits, _mm256_and_si256(bytes, mask));
+    // Unpacking works within 128-bit lanes: lo has bytes 0-7 and 16-23, hi
+    // has bytes 8-15 and 24-31.
+    __m256i lo = _mm256_unpacklo_epi8(high_nibbles, low_nibbles);
+    __m256i hi = _mm256_unpackhi_epi8(high_nibbles, low_nibbles);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out),
+                        _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 32),
+                        _mm256_permute2x128_si256(lo, hi, 0x31));
+  }
+  return format_ssse3(data + i, size - i, out, plain);
+}
+
+void avx2(benchmark::State& state) {
+  if (!__builtin_cpu_supports("avx2")) {
+    state.SkipWithError("AVX2 is not supported");
+    return;
+  }
+  run(state, format_avx2);
+}
+BENCHMARK(avx2)
+    ->ArgNames({"size", "mode"})
+    ->ArgsProduct({benchmark::CreateRange(16, 1 << 20, 16), {plain}});
+#endif
@@ -0,0 +1,49 @@
+// Hexadecimal encoding of bytes shared by the hex dump and network type
+// benchmarks.
+//
+// Copyright (c) 2019 - present, Victor Zverovich
+// All rights reserved.
+
+#ifndef HEX_H_
+#define HEX_H_
+
+#include <stdint.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#  include <immintrin.h>
+#  define HAVE_SIMD
+#endif
+
+// A table of two hex digits for every byte.
+struct hex_table {
+  char entries[256][2];
+
+  constexpr hex_table() : entries() {
+    for (int i = 0; i < 256; ++i) {
+      entries[i][0] = "0123456789abcdef"[i >> 4];
+      entries[i][1] = "0123456789abcdef"[i & 0xf];
+    }
+  }
+};
+
+inline constexpr hex_table hex_digits{};
+
+#ifdef HAVE_SIMD
+// Returns the hex digits of 16 bytes: the first 8 bytes in lo and the last
+// 8 in hi. The caller must check that SSSE3 is supported.
+__attribute__((target("ssse3"))) inline void encode16(const uint8_t* data,
+                                                      __m128i& lo,
+                                                      __m128i& hi) {
+  const __m128i digits = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+                                       '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+  const __m128i mask = _mm_set1_epi8(0xf);
+  __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+  __m128i high_nibbles =
+      _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(bytes, 4), mask));
+  __m128i low_nibbles = _mm_shuffle_epi8(digits, _mm_and_si128(bytes, mask));
+  lo = _mm_unpacklo_epi8(high_nibbles, low_nibbles);
+  hi = _mm_unpackhi_epi8(high_nibbles, low_nibbles);
+}
+#endif
+
+#endif  // HEX_H_
@@ -0,0 +1,109 @@
+// A counter of retired instructions for results that can be compared across
+// machines unlike wall-clock time.
+//
+// It uses perf_event_open to count user-space instructions in-process. If the
+// program runs under callgrind, where the hardware counters would count
+// valgrind itself, the measured regions are marked with client requests
+// instead and the counts are written to the callgrind dumps:
+//
+//   valgrind --tool=callgrind --collect-atstart=no <benchmark>
+//   callgrind_annotate callgrind.out.<pid>.<n>
+//
+// Copyright (c) 2019 - present, Victor Zverovich
+// All rights reserved.
+
+#ifndef INSTRUCTION_COUNTER_H_
+#define INSTRUCTION_COUNTER_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __linux__
+#  include <linux/perf_event.h>
+#  include <sys/ioctl.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#endif
+
+#if __has_include(<valgrind/callgrind.h>)
+#  include <valgrind/callgrind.h>
+#  define HAVE_CALLGRIND
+#endif
+
+class instruction_counter {
+ private:
+  int fd_ = -1;
+  bool callgrind_ = false;
+
+ public:
+  instruction_counter() {
+#ifdef HAVE_CALLGRIND
+    callgrind_ = RUNNING_ON_VALGRIND != 0;
+    if (callgrind_) return;
+#endif
+#ifdef __linux__
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd_ = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+  }
+
+  ~instruction_counter() {
+#ifdef __linux__
+    if (fd_ >= 0) close(fd_);
+#endif
+  }
+
+  instruction_counter(const instruction_counter&) = delete;
+  void operator=(const instruction_counter&) = delete;
+
+  // Returns true if stop returns instruction counts.
+  bool available() const { return fd_ >= 0; }
+
+  // Returns true if the counts are written to callgrind dumps.
+  bool callgrind() const { return callgrind_; }
+
+  void start() {
+#ifdef HAVE_CALLGRIND
+    if (callgrind_) {
+      CALLGRIND_ZERO_STATS;
+      CALLGRIND_TOGGLE_COLLECT;
+      return;
+    }
+#endif
+#ifdef __linux__
+    if (fd_ < 0) return;
+    ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+  }
+
+  // Stops counting and returns the number of instructions retired since the
+  // last call to start or 0 if the counts are not available in-process.
+  // label identifies the callgrind dump.
+  uint64_t stop(const char* label) {
+#ifdef HAVE_CALLGRIND
+    if (callgrind_) {
+      CALLGRIND_TOGGLE_COLLECT;
+      CALLGRIND_DUMP_STATS_AT(label);
+      return 0;
+    }
+#endif
+    (void)label;
+    uint64_t count = 0;
+#ifdef __linux__
+    if (fd_ < 0) return 0;
+    ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(fd_, &count, sizeof(count)) != sizeof(count)) count = 0;
+#endif
+    return count;
+  }
+};
+
+#endif  // INSTRUCTION_COUNTER_H_
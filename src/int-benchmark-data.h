@@ -0,0 +1,79 @@
+// Input data for the integer conversion benchmarks.
+//
+// Copyright (c) 2019 - present, Victor Zverovich
+// All rights reserved.
+
+#ifndef INT_BENCHMARK_DATA_H_
+#define INT_BENCHMARK_DATA_H_
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <vector>
+
+// Computes a digest of data. It is used both to prevent compiler from
+// optimizing away the benchmarked code and to verify that the results are
+// correct. The overhead is less than 2.5% compared to just DoNotOptimize.
+FMT_INLINE unsigned compute_digest(fmt::string_view data) {
+  unsigned digest = 0;
+  for (char c : data) digest += c;
+  return digest;
+}
+
+// Generates n values similar to the ones in Boost Karma int generator test:
+// https://www.boost.org/doc/libs/1_63_0/libs/spirit/workbench/karma/int_generator.cpp
+// with rand replaced by uniform_int_distribution for consistent results across
+// platforms.
+inline std::vector<int> generate_values(size_t n) {
+  std::vector<int> values(n);
+  std::mt19937 gen;
+  std::uniform_int_distribution<unsigned> dist(
+      0, (std::numeric_limits<int>::max)());
+  std::generate(values.begin(), values.end(), [&]() {
+    int scale = dist(gen) / 100 + 1;
+    return static_cast<int>(dist(gen) * dist(gen)) / scale;
+  });
+  return values;
+}
+
+struct Data {
+  std::vector<int> values;
+  unsigned digest;
+
+  auto begin() const { return values.begin(); }
+  auto end() const { return values.end(); }
+
+  // Prints the number of values by digit count, e.g.
+  //  1  27263
+  //  2 247132
+  //  3 450601
+  //  4 246986
+  //  5  25188
+  //  6   2537
+  //  7    251
+  //  8     39
+  //  9      2
+  // 10      1
+  void print_digit_counts() const {
+    int counts[11] = {};
+    for (auto value : values) ++counts[fmt::format_int(value).size()];
+    fmt::print("The number of values by digit count:\n");
+    for (int i = 1; i < 11; ++i) fmt::print("{:2} {:6}\n", i, counts[i]);
+  }
+
+  Data() : values(generate_values(1'000'000)) {
+    digest =
+        std::accumulate(begin(), end(), unsigned(), [](unsigned lhs, int rhs) {
+          char buffer[12];
+          unsigned size = std::sprintf(buffer, "%d", rhs);
+          return lhs + compute_digest({buffer, size});
+        });
+    print_digit_counts();
+  }
+};
+
+#endif  // INT_BENCHMARK_DATA_H_
@@ -8,10 +8,10 @@
 
 #include <algorithm>
 #include <charconv>
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
-#include <limits>
-#include <numeric>
+#include <cstring>
 #include <random>
 #include <sstream>
 #include <string>
@@ -24,6 +24,10 @@
 #  define HAVE_BOOST
 #endif
 
+#include "bounded-int.h"
+#include "instruction-counter.h"
+#include "int-benchmark-data.h"
+#include "itoa-benchmark/itoa_swar.h"
 #include "itostr.cc"
 #include "u2985907.h"
 
@@ -91,81 +95,72 @@ char* ltoa(long N, char* str, int base) {
   return str;
 }
 
-// Computes a digest of data. It is used both to prevent compiler from
-// optimizing away the benchmarked code and to verify that the results are
-// correct. The overhead is less than 2.5% compared to just DoNotOptimize.
-FMT_INLINE unsigned compute_digest(fmt::string_view data) {
-  unsigned digest = 0;
-  for (char c : data) digest += c;
-  return digest;
-}
-
-struct Data {
-  std::vector<int> values;
-  unsigned digest;
-
-  auto begin() const { return values.begin(); }
-  auto end() const { return values.end(); }
-
-  // Prints the number of values by digit count, e.g.
-  //  1  27263
-  //  2 247132
-  //  3 450601
-  //  4 246986
-  //  5  25188
-  //  6   2537
-  //  7    251
-  //  8     39
-  //  9      2
-  // 10      1
-  void print_digit_counts() const {
-    int counts[11] = {};
-    for (auto value : values) ++counts[fmt::format_int(value).size()];
-    fmt::print("The number of values by digit count:\n");
-    for (int i = 1; i < 11; ++i) fmt::print("{:2} {:6}\n", i, counts[i]);
-  }
-
-  Data() : values(1'000'000) {
-    // Similar data as in Boost Karma int generator test:
-    // https://www.boost.org/doc/libs/1_63_0/libs/spirit/workbench/karma/int_generator.cpp
-    // with rand replaced by uniform_int_distribution for consistent results
-    // across platforms.
-    std::mt19937 gen;
-    std::uniform_int_distribution<unsigned> dist(
-        0, (std::numeric_limits<int>::max)());
-    std::generate(values.begin(), values.end(), [&]() {
-      int scale = dist(gen) / 100 + 1;
-      return static_cast<int>(dist(gen) * dist(gen)) / scale;
-    });
-    digest =
-        std::accumulate(begin(), end(), unsigned(), [](unsigned lhs, int rhs) {
-          char buffer[12];
-          unsigned size = std::sprintf(buffer, "%d", rhs);
-          return lhs + compute_digest({buffer, size});
-        });
-    print_digit_counts();
-  }
-} data;
+Data data;
 
+// Checks the digest and reports the number of instructions per item which,
+// unlike time, is the same on different machines with the same compiler and
+// standard library. Iterating over DigestChecker instead of state counts the
+// instructions of the loop only and not of the framework setup and teardown.
+// See instruction-counter.h for running under callgrind, where each run is
+// dumped under the benchmark name and the number of iterations.
 struct DigestChecker {
   benchmark::State& state;
   unsigned digest = 0;
+  instruction_counter counter;
+  std::string label;
+  bool counting = false;
+  uint64_t instructions = 0;
 
-  explicit DigestChecker(benchmark::State& s) : state(s) {}
+  DigestChecker(benchmark::State& s, const char* name)
+      : state(s),
+        label(fmt::format("{}/iterations:{}", name, s.max_iterations)) {}
 
   ~DigestChecker() noexcept(false) {
+    stop();
+    auto items = state.iterations() * data.values.size();
     if (digest != static_cast<unsigned>(state.iterations()) * data.digest)
       throw std::logic_error("invalid length");
-    state.SetItemsProcessed(state.iterations() * data.values.size());
+    state.SetItemsProcessed(items);
+    if (counter.available())
+      state.counters["insns_per_item"] =
+          static_cast<double>(instructions) / items;
     benchmark::DoNotOptimize(digest);
   }
 
+  void stop() {
+    if (!counting) return;
+    instructions = counter.stop(label.c_str());
+    counting = false;
+  }
+
+  // Returns true if there is another iteration starting the counter after
+  // the first call to KeepRunning and stopping it before the last one.
+  bool keep_running() {
+    if (state.iterations() == state.max_iterations) stop();
+    if (!state.KeepRunning()) return false;
+    if (!counting && state.iterations() == 1) {
+      counting = true;
+      counter.start();
+    }
+    return true;
+  }
+
+  struct iterator {
+    DigestChecker* checker;
+    bool operator!=(const iterator&) const { return checker->keep_running(); }
+    void operator++() {}
+    int operator*() const { return 0; }
+  };
+
+  iterator begin() { return {this}; }
+  iterator end() { return {this}; }
+
   FMT_INLINE void add(fmt::string_view s) { digest += compute_digest(s); }
 };
 
 void sprintf(benchmark::State& state) {
-  auto dc = DigestChecker(state);
-  for (auto s : state) {
+  auto dc = DigestChecker(state, __func__);
+  for (auto s : dc) {
     for (auto value : data) {
       char buffer[12];
       unsigned size = std::sprintf(buffer, "%d", value);
@@ -176,9 +171,9 @@ void sprintf(benchmark::State& state) {
 BENCHMARK(sprintf);
 
 void std_ostringstream(benchmark::State& state) {
-  auto dc = DigestChecker(state);
+  auto dc = DigestChecker(state, __func__);
   std::ostringstream os;
-  for (auto s : state) {
+  for (auto s : dc) {
     for (auto value : data) {
       os.str(std::string());
       os << value;
@@ -190,8 +185,8 @@ void std_ostringstream(benchmark::State& state) {
 BENCHMARK(std_ostringstream);
 
 void std_to_string(benchmark::State& state) {
-  auto dc = DigestChecker(state);
-  for (auto s : state) {
+  auto dc = DigestChecker(state, __func__);
+  for (auto s : dc) {
     for (auto value : data) {
       std::string s = std::to_string(value);
       dc.add(s);
@@ -201,8 +196,8 @@ void std_to_string(benchmark::State& state) {
 BENCHMARK(std_to_string);
 
 void std_to_chars(benchmark::State& state) {
-  auto dc = DigestChecker(state);
-  for (auto s : state) {
+  auto dc = DigestChecker(state, __func__);
+  for (auto s : dc) {
     for (auto value : data) {
       char buffer[12];
       auto res = std::to_chars(buffer, buffer + sizeof(buffer), value);
@@ -214,8 +209,8 @@ void std_to_chars(benchmark::State& state) {
 BENCHMARK(std_to_chars);
 
 void fmt_to_string(benchmark::State& state) {
-  auto dc = DigestChecker(state);
-  for (auto s : state) {
+  auto dc = DigestChecker(state, __func__);
+  for (auto s : dc) {
     for (auto value : data) {
       std::string s = fmt::to_string(value);
       dc.add(s);
@@ -225,8 +220,8 @@ void fmt_to_string(benchmark::State& state) {
 BENCHMARK(fmt_to_string);
 
 void fmt_format_runtime(benchmark::State& state) {
-  auto dc = DigestChecker(state);
-  for (auto s : state) {
+  auto dc = DigestChecker(state, __func__);
+  for (auto s : dc) {
     for (auto value : data) {
       std::string s = fmt::format("{}", value);
       dc.add(s);
@@ -236,8 +231,8 @@ void fmt_format_runtime(benchmark::State& state) {
 BENCHMARK(fmt_format_runtime);
 
 void fmt_format_compile(benchmark::State& state) {
-  auto dc = DigestChecker(state);
-  for (auto s : state) {
+  auto dc = DigestChecker(state, __func__);
+  for (auto s : dc) {
     for (auto value : data) {
       std::string s = fmt::format(FMT_COMPILE("{}"), value);
       dc.add(s);
@@ -247,8 +242,8 @@ void fmt_format_compile(benchmark::State& state) {
 BENCHMARK(fmt_format_compile);
 
 void fmt_format_to_runtime(benchmark::State& state) {
-  auto dc = DigestChecker(state);
-  for (auto s : state) {
+  auto dc = DigestChecker(state, __func__);
+  for (auto s : dc) {
     for (auto value : data) {
       char buffer[12];
       auto end = fmt::format_to(buffer, "{}", value);
@@ -260,8 +255,8 @@ void fmt_format_to_runtime(benchmark::State& state) {
 BENCHMARK(fmt_format_to_runtime);
 
 void fmt_format_to_compile(benchmark::State& state) {
-  auto dc = DigestChecker(state);
-  for (auto s : state) {
+  auto dc = DigestChecker(state, __func__);
+  for (auto s : dc) {
     for (auto value : data) {
       char buffer[12];
       auto end = fmt::format_to(buffer, FMT_COMPILE("{}"), value);
@@ -273,8 +268,8 @@ void fmt_format_to_compile(benchmark::State& state) {
 BENCHMARK(fmt_format_to_compile);
 
 void fmt_format_int(benchmark::State& state) {
-  auto dc = DigestChecker(state);
-  for (auto s : state) {
+  auto dc = DigestChecker(state, __func__);
+  for (auto s : dc) {
     for (auto value : data) {
       auto f = fmt::format_int(value);
       dc.add({f.data(), f.size()});
@@ -285,8 +280,8 @@ BENCHMARK(fmt_format_int);
 
 #ifdef HAVE_BOOST
 void boost_lexical_cast(benchmark::State& state) {
-  auto dc = DigestChecker(state);
-  for (auto s : state) {
+  auto dc = DigestChecker(state, __func__);
+  for (auto s : dc) {
     for (auto value : data) {
       std::string s = boost::lexical_cast<std::string>(value);
       dc.add(s);
@@ -296,9 +291,9 @@ void boost_lexical_cast(benchmark::State& state) {
 BENCHMARK(boost_lexical_cast);
 
 void boost_format(benchmark::State& state) {
-  auto dc = DigestChecker(state);
+  auto dc = DigestChecker(state, __func__);
   boost::format fmt("%d");
-  for (auto s : state) {
+  for (auto s : dc) {
     for (auto value : data) {
       std::string s = boost::str(fmt % value);
       dc.add(s);
@@ -308,8 +303,8 @@ void boost_format(benchmark::State& state) {
 BENCHMARK(boost_format);
 
 void boost_karma_generate(benchmark::State& state) {
-  auto dc = DigestChecker(state);
-  for (auto s : state) {
+  auto dc = DigestChecker(state, __func__);
+  for (auto s : dc) {
     for (auto value : data) {
       char buffer[12];
       char* ptr = buffer;
@@ -323,8 +318,8 @@ BENCHMARK(boost_karma_generate);
 #endif
 
 void voigt_itostr(benchmark::State& state) {
-  auto dc = DigestChecker(state);
-  for (auto s : state) {
+  auto dc = DigestChecker(state, __func__);
+  for (auto s : dc) {
     for (auto value : data) {
       std::string s = itostr(value);
       dc.add(s);
@@ -334,8 +329,8 @@ void voigt_itostr(benchmark::State& state) {
 BENCHMARK(voigt_itostr);
 
 void u2985907(benchmark::State& state) {
-  auto dc = DigestChecker(state);
-  for (auto s : state) {
+  auto dc = DigestChecker(state, __func__);
+  for (auto s : dc) {
     for (auto value : data) {
       char buffer[12];
       unsigned size = so_u2985907::ufast_itoa10(value, buffer);
@@ -346,8 +341,8 @@ void u2985907(benchmark::State& state) {
 BENCHMARK(u2985907);
 
 void decimal_from(benchmark::State& state) {
-  auto dc = DigestChecker(state);
-  for (auto s : state) {
+  auto dc = DigestChecker(state, __func__);
+  for (auto s : dc) {
     for (auto value : data) {
       char buffer[12];
       auto end = cppx::decimal_from(value, buffer);
@@ -358,9 +353,22 @@ void decimal_from(benchmark::State& state) {
 }
 BENCHMARK(decimal_from);
 
+void swar(benchmark::State& state) {
+  auto dc = DigestChecker(state, __func__);
+  for (auto s : dc) {
+    for (auto value : data) {
+      char buffer[12];
+      auto end = itoa_swar::i32toa(value, buffer);
+      unsigned size = end - buffer;
+      dc.add({buffer, size});
+    }
+  }
+}
+BENCHMARK(swar);
+
 void stout_ltoa(benchmark::State& state) {
-  auto dc = DigestChecker(state);
-  for (auto s : state) {
+  auto dc = DigestChecker(state, __func__);
+  for (auto s : dc) {
     for (auto value : data) {
       char buffer[12];
       ltoa(value, buffer, 10);
@@ -371,4 +379,197 @@ void stout_ltoa(benchmark::State& state) {
 }
 BENCHMARK(stout_ltoa);
 
-BENCHMARK_MAIN();
+// Values uniformly distributed in [Min, Max] and their digest.
+template <uint32_t Min, uint32_t Max> struct BoundedData {
+  std::vector<uint32_t> values;
+  unsigned digest = 0;
+
+  BoundedData() : values(1'000'000) {
+    std::mt19937 gen;
+    std::uniform_int_distribution<uint32_t> dist(Min, Max);
+    for (auto& value : values) {
+      value = dist(gen);
+      auto f = fmt::format_int(value);
+      digest += compute_digest({f.data(), f.size()});
+    }
+  }
+};
+
+template <uint32_t Min, uint32_t Max, typename F>
+void run_bounded(benchmark::State& state, F format) {
+  static const BoundedData<Min, Max> data;
+  unsigned digest = 0;
+  for (auto s : state) {
+    for (auto value : data.values) {
+      char buffer[16];
+      digest += compute_digest({buffer, format(value, buffer)});
+    }
+  }
+  if (digest != static_cast<unsigned>(state.iterations()) * data.digest)
+    throw std::logic_error("invalid digest");
+  state.SetItemsProcessed(state.iterations() * data.values.size());
+}
+
+template <uint32_t Min, uint32_t Max>
+void bounded_fmt_format_int(benchmark::State& state) {
+  run_bounded<Min, Max>(state, [](uint32_t value, char* buffer) -> size_t {
+    auto f = fmt::format_int(value);
+    std::memcpy(buffer, f.data(), f.size());
+    return f.size();
+  });
+}
+
+template <uint32_t Min, uint32_t Max>
+void bounded_fmt_format_to_compile(benchmark::State& state) {
+  run_bounded<Min, Max>(state, [](uint32_t value, char* buffer) -> size_t {
+    return fmt::format_to(buffer, FMT_COMPILE("{}"), value) - buffer;
+  });
+}
+
+template <uint32_t Min, uint32_t Max>
+void bounded_format(benchmark::State& state) {
+  run_bounded<Min, Max>(state, [](uint32_t value, char* buffer) -> size_t {
+    return bounded::format<Min, Max>(value, buffer) - buffer;
+  });
+}
+
+// Ranges of HTTP status codes, percentages, milliseconds and ports.
+#define BOUNDED_BENCHMARKS(min, max)                           \
+  BENCHMARK_TEMPLATE(bounded_fmt_format_int, min, max);        \
+  BENCHMARK_TEMPLATE(bounded_fmt_format_to_compile, min, max); \
+  BENCHMARK_TEMPLATE(bounded_format, min, max)
+
+BOUNDED_BENCHMARKS(100, 599);
+BOUNDED_BENCHMARKS(0, 100);
+BOUNDED_BENCHMARKS(0, 999);
+BOUNDED_BENCHMARKS(0, 65535);
+
+// Writes to a scratch buffer of the given size to evict lookup tables used by
+// the conversion functions from the caches.
+void evict_caches(size_t size) {
+  static std::vector<char> scratch;
+  if (scratch.size() < size) scratch.resize(size);
+  for (size_t i = 0; i < size; i += 64) ++scratch[i];
+  benchmark::DoNotOptimize(scratch.data());
+  benchmark::ClobberMemory();
+}
+
+// Returns the median time of an empty timed region, i.e. of two clock reads,
+// which is comparable to a single conversion and is subtracted from samples.
+double clock_overhead() {
+  static const double overhead = [] {
+    std::vector<double> samples(10'000);
+    for (auto& sample : samples) {
+      auto start = std::chrono::steady_clock::now();
+      auto end = std::chrono::steady_clock::now();
+      sample = std::chrono::duration<double>(end - start).count();
+    }
+    auto median = samples.begin() + samples.size() / 2;
+    std::nth_element(samples.begin(), median, samples.end());
+    return *median;
+  }();
+  return overhead;
+}
+
+// Measures conversions of batches of state.range(1) values each preceded by
+// a sweep over state.range(0) KiB of memory to model formatting interleaved
+// with other work. Only the conversions are timed and the clock overhead is
+// subtracted from each sample.
+template <typename F> void run_cold(benchmark::State& state, F convert) {
+  auto scratch_size = static_cast<size_t>(state.range(0)) * 1024;
+  auto batch = static_cast<size_t>(state.range(1));
+  size_t index = 0, n = data.values.size();
+  unsigned digest = 0;
+  double overhead = clock_overhead();
+  for (auto s : state) {
+    evict_caches(scratch_size);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < batch; ++i) {
+      char buffer[12];
+      digest += compute_digest({buffer, convert(data.values[index], buffer)});
+      if (++index == n) index = 0;
+    }
+    auto end = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(end - start).count();
+    state.SetIterationTime((std::max)(elapsed - overhead, 0.0));
+  }
+  // Verify the results outside of the timed region.
+  unsigned expected = 0;
+  for (size_t i = 0, count = state.iterations() * batch; i < count; ++i) {
+    auto f = fmt::format_int(data.values[i % n]);
+    expected += compute_digest({f.data(), f.size()});
+  }
+  if (digest != expected) throw std::logic_error("invalid digest");
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+
+// The number of iterations is fixed because the minimum time is compared to
+// the manual time which excludes the comparatively slow sweeps.
+void cold_args(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"scratch_kib", "batch"})
+      ->ArgsProduct({{0, 4096}, {1, 16}})
+      ->UseManualTime()
+      ->Iterations(2000);
+}
+
+void cold_sprintf(benchmark::State& state) {
+  run_cold(state, [](int value, char* buffer) -> size_t {
+    return std::sprintf(buffer, "%d", value);
+  });
+}
+BENCHMARK(cold_sprintf)->Apply(cold_args);
+
+void cold_std_to_chars(benchmark::State& state) {
+  run_cold(state, [](int value, char* buffer) -> size_t {
+    return std::to_chars(buffer, buffer + 12, value).ptr - buffer;
+  });
+}
+BENCHMARK(cold_std_to_chars)->Apply(cold_args);
+
+void cold_fmt_format_to_compile(benchmark::State& state) {
+  run_cold(state, [](int value, char* buffer) -> size_t {
+    return fmt::format_to(buffer, FMT_COMPILE("{}"), value) - buffer;
+  });
+}
+BENCHMARK(cold_fmt_format_to_compile)->Apply(cold_args);
+
+void cold_u2985907(benchmark::State& state) {
+  run_cold(state, [](int value, char* buffer) -> size_t {
+    return so_u2985907::ufast_itoa10(value, buffer);
+  });
+}
+BENCHMARK(cold_u2985907)->Apply(cold_args);
+
+void cold_decimal_from(benchmark::State& state) {
+  run_cold(state, [](int value, char* buffer) -> size_t {
+    return cppx::decimal_from(value, buffer) - buffer;
+  });
+}
+BENCHMARK(cold_decimal_from)->Apply(cold_args);
+
+void cold_swar(benchmark::State& state) {
+  run_cold(state, [](int value, char* buffer) -> size_t {
+    return itoa_swar::i32toa(value, buffer) - buffer;
+  });
+}
+BENCHMARK(cold_swar)->Apply(cold_args);
+
+// Table-based kernels from itoa-benchmark whose tables are evicted by the
+// sweep. countlut computes the number of digits first like fmt. They write
+// a null-terminated string so strlen gives the size.
+void i32toa_branchlut(int32_t value, char* buffer);
+void i32toa_countlut(int32_t value, char* buffer);
+void i32toa_lut(int32_t value, char* buffer);
+void i32toa_unrolledlut(int32_t value, char* buffer);
+
+template <void (*i32toa)(int32_t, char*)>
+void cold_itoa(benchmark::State& state) {
+  run_cold(state, [](int value, char* buffer) -> size_t {
+    i32toa(value, buffer);
+    return std::strlen(buffer);
+  });
+}
+BENCHMARK_TEMPLATE(cold_itoa, i32toa_branchlut)->Apply(cold_args);
+BENCHMARK_TEMPLATE(cold_itoa, i32toa_countlut)->Apply(cold_args);
+BENCHMARK_TEMPLATE(cold_itoa, i32toa_lut)->Apply(cold_args);
+BENCHMARK_TEMPLATE(cold_itoa, i32toa_unrolledlut)->Apply(cold_args);
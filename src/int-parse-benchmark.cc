@@ -0,0 +1,173 @@
+// A decimal string to integer conversion benchmark, the reverse of
+// int-benchmark. The same values are formatted once and parsed back.
+//
+// Copyright (c) 2019 - present, Victor Zverovich
+// All rights reserved.
+
+#include <benchmark/benchmark.h>
+
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if __has_include(<boost/lexical_cast.hpp>)
+#  include <boost/lexical_cast.hpp>
+#  define HAVE_BOOST
+#endif
+
+#include "int-benchmark-data.h"
+
+Data data;
+
+// The values from data separated by newlines.
+struct Input {
+  std::string text;
+  // Individual values for the methods that require a null-terminated string
+  // or std::string. sscanf is also given those because glibc's sscanf calls
+  // strlen on the whole input.
+  std::vector<std::string> strings;
+  unsigned sum = 0;
+
+  Input() {
+    for (auto value : data) {
+      auto s = fmt::format_int(value);
+      text.append(s.data(), s.size());
+      text.push_back('\n');
+      strings.emplace_back(s.data(), s.size());
+      sum += static_cast<unsigned>(value);
+    }
+    // Padding for the 8-byte loads in the SWAR parser.
+    text.append(8, '\0');
+  }
+} input;
+
+// Computes a sum of parsed values and checks it against the sum of the
+// original ones.
+struct SumChecker {
+  benchmark::State& state;
+  unsigned sum = 0;
+
+  explicit SumChecker(benchmark::State& s) : state(s) {}
+
+  ~SumChecker() noexcept(false) {
+    if (sum != static_cast<unsigned>(state.iterations()) * input.sum)
+      throw std::logic_error("invalid sum");
+    state.SetItemsProcessed(state.iterations() * data.values.size());
+    state.SetBytesProcessed(state.iterations() * (input.text.size() - 8));
+    benchmark::DoNotOptimize(sum);
+  }
+
+  FMT_INLINE void add(int value) { sum += static_cast<unsigned>(value); }
+};
+
+// Parsing 8 digits at once as described in
+// https://lemire.me/blog/2022/01/21/swar-explained-parsing-eight-digits/.
+// Assumes a little-endian target.
+namespace swar {
+inline bool is_eight_digits(uint64_t chunk) {
+  return ((chunk & 0xF0F0F0F0F0F0F0F0) |
+          (((chunk + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) ==
+         0x3333333333333333;
+}
+
+inline uint32_t parse_eight_digits(uint64_t chunk) {
+  chunk = (chunk & 0x0F0F0F0F0F0F0F0F) * 2561 >> 8;
+  chunk = (chunk & 0x00FF00FF00FF00FF) * 6553601 >> 16;
+  return static_cast<uint32_t>((chunk & 0x0000FFFF0000FFFF) * 42949672960001 >>
+                               32);
+}
+
+// Parses a decimal integer without overflow checks and returns a pointer past
+// the last digit. Reads up to 8 bytes past the start of the digits.
+inline const char* parse(const char* p, int& value) {
+  bool negative = *p == '-';
+  p += negative;
+  uint64_t chunk;
+  std::memcpy(&chunk, p, sizeof(chunk));
+  uint32_t result = 0;
+  if (is_eight_digits(chunk)) {
+    result = parse_eight_digits(chunk);
+    p += 8;
+  }
+  for (unsigned d; (d = static_cast<unsigned char>(*p) - '0') < 10; ++p)
+    result = result * 10 + d;
+  value = static_cast<int>(negative ? 0 - result : result);
+  return p;
+}
+}  // namespace swar
+
+void std_from_chars(benchmark::State& state) {
+  auto sc = SumChecker(state);
+  const char* end = input.text.data() + input.text.size();
+  for (auto s : state) {
+    const char* p = input.text.data();
+    for (size_t i = 0, n = data.values.size(); i < n; ++i) {
+      int value = 0;
+      p = std::from_chars(p, end, value).ptr + 1;
+      sc.add(value);
+    }
+  }
+}
+BENCHMARK(std_from_chars);
+
+void strtol(benchmark::State& state) {
+  auto sc = SumChecker(state);
+  for (auto s : state) {
+    const char* p = input.text.data();
+    for (size_t i = 0, n = data.values.size(); i < n; ++i) {
+      char* end = nullptr;
+      sc.add(static_cast<int>(std::strtol(p, &end, 10)));
+      p = end + 1;
+    }
+  }
+}
+BENCHMARK(strtol);
+
+void std_stoi(benchmark::State& state) {
+  auto sc = SumChecker(state);
+  for (auto s : state) {
+    for (const auto& str : input.strings) sc.add(std::stoi(str));
+  }
+}
+BENCHMARK(std_stoi);
+
+void sscanf(benchmark::State& state) {
+  auto sc = SumChecker(state);
+  for (auto s : state) {
+    for (const auto& str : input.strings) {
+      int value = 0;
+      std::sscanf(str.c_str(), "%d", &value);
+      sc.add(value);
+    }
+  }
+}
+BENCHMARK(sscanf);
+
+#ifdef HAVE_BOOST
+void boost_lexical_cast(benchmark::State& state) {
+  auto sc = SumChecker(state);
+  for (auto s : state) {
+    for (const auto& str : input.strings)
+      sc.add(boost::lexical_cast<int>(str.data(), str.size()));
+  }
+}
+BENCHMARK(boost_lexical_cast);
+#endif
+
+void swar_parse(benchmark::State& state) {
+  auto sc = SumChecker(state);
+  for (auto s : state) {
+    const char* p = input.text.data();
+    for (size_t i = 0, n = data.values.size(); i < n; ++i) {
+      int value = 0;
+      p = swar::parse(p, value) + 1;
+      sc.add(value);
+    }
+  }
+}
+BENCHMARK(swar_parse);
@@ -0,0 +1,118 @@
+#ifndef ITOA_SWAR_H
+#define ITOA_SWAR_H
+
+// SWAR (SIMD within a register) integer to ASCII conversion
+//
+// Converts 8 digits at once in a uint64_t using multiply-shift division of
+// packed lanes: 32-bit lanes by 100, then 16-bit lanes by 10. It needs
+// neither lookup tables nor SIMD instructions.
+//
+// The functions return a pointer past the last written digit and don't write
+// the NUL terminator. They may write up to 8 bytes at the end of the number
+// so the buffer must have room for the maximum number of digits.
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace itoa_swar {
+
+// Returns the digits of value < 100000000 in the bytes of the result, most
+// significant digit in the lowest byte.
+inline uint64_t EncodeEightDigits(uint32_t value) {
+    // 32-bit lanes: abcd efgh
+    const uint64_t abcd_efgh = (value / 10000) | (uint64_t(value % 10000) << 32);
+    // x / 100 = x * 10486 >> 20 for x < 10000 and the products fit in lanes.
+    const uint64_t ab_ef = ((abcd_efgh * 10486) >> 20) & 0x0000007F0000007F;
+    // 16-bit lanes: ab cd ef gh
+    const uint64_t ab_cd_ef_gh = ab_ef | ((abcd_efgh - ab_ef * 100) << 16);
+    // x / 10 = x * 103 >> 10 for x < 100.
+    const uint64_t tens = ((ab_cd_ef_gh * 103) >> 10) & 0x000F000F000F000F;
+    // 8-bit lanes: a b c d e f g h
+    return tens | ((ab_cd_ef_gh - tens * 10) << 8);
+}
+
+inline void StoreAscii(uint64_t digits, char* buffer) {
+    digits += 0x3030303030303030;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    digits = __builtin_bswap64(digits);
+#endif
+    memcpy(buffer, &digits, 8);
+}
+
+// Returns the number of leading zero digits in the encoded digits of a
+// nonzero value or 7 if it is zero.
+inline unsigned CountLeadingZeroDigits(uint64_t digits) {
+    digits |= uint64_t(1) << 56;
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, digits);
+    return index / 8;
+#else
+    return __builtin_ctzll(digits) / 8;
+#endif
+}
+
+// Writes value < 100000000 with exactly 8 digits.
+inline char* WriteEightDigits(uint32_t value, char* buffer) {
+    StoreAscii(EncodeEightDigits(value), buffer);
+    return buffer + 8;
+}
+
+// Writes value < 100000000 without leading zeros.
+inline char* WriteUpToEightDigits(uint32_t value, char* buffer) {
+    uint64_t digits = EncodeEightDigits(value);
+    unsigned zeros = CountLeadingZeroDigits(digits);
+    StoreAscii(digits >> (zeros * 8), buffer);
+    return buffer + 8 - zeros;
+}
+
+inline char* u32toa(uint32_t value, char* buffer) {
+    if (value < 100000000)
+        return WriteUpToEightDigits(value, buffer);
+    // value = aabbbbbbbb in decimal
+    const uint32_t a = value / 100000000; // 1 to 42
+    if (a >= 10)
+        *buffer++ = '0' + static_cast<char>(a / 10);
+    *buffer++ = '0' + static_cast<char>(a % 10);
+    return WriteEightDigits(value % 100000000, buffer);
+}
+
+inline char* i32toa(int32_t value, char* buffer) {
+    uint32_t u = static_cast<uint32_t>(value);
+    if (value < 0) {
+        *buffer++ = '-';
+        u = ~u + 1;
+    }
+    return u32toa(u, buffer);
+}
+
+inline char* u64toa(uint64_t value, char* buffer) {
+    if (value < 100000000)
+        return WriteUpToEightDigits(static_cast<uint32_t>(value), buffer);
+    if (value < 10000000000000000) {
+        buffer = WriteUpToEightDigits(static_cast<uint32_t>(value / 100000000), buffer);
+        return WriteEightDigits(static_cast<uint32_t>(value % 100000000), buffer);
+    }
+    // value = aaaabbbbbbbbcccccccc in decimal
+    const uint64_t ab = value / 100000000;
+    buffer = WriteUpToEightDigits(static_cast<uint32_t>(ab / 100000000), buffer);
+    buffer = WriteEightDigits(static_cast<uint32_t>(ab % 100000000), buffer);
+    return WriteEightDigits(static_cast<uint32_t>(value % 100000000), buffer);
+}
+
+inline char* i64toa(int64_t value, char* buffer) {
+    uint64_t u = static_cast<uint64_t>(value);
+    if (value < 0) {
+        *buffer++ = '-';
+        u = ~u + 1;
+    }
+    return u64toa(u, buffer);
+}
+
+}
+
+#endif // ITOA_SWAR_H
@@ -1,21 +1,76 @@
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <cstdio>
 #include <cstring>
 #include <exception>
 #include <limits>
 #include <random>
 #include <string>
+#include <vector>
 #include <stdint.h>
 #include <stdlib.h>
 #include "resultfilename.h"
 #include "timer.h"
 #include "test.h"
+#include "../instruction-counter.h"
 
 const unsigned kIterationPerDigit = 100000;
 const unsigned kIterationForRandom = 100;
 const unsigned kTrial = 10;
 
+// If true, measure the number of instructions per operation instead of time.
+static bool gInstructions = false;
+
+// If nonzero, the size of the scratch buffer written before each conversion
+// to evict lookup tables from the caches.
+static size_t gColdBytes = 0;
+const size_t kDefaultColdBytes = 4 << 20;
+const unsigned kColdSamples = 10000;
+
+// Measures time in nanoseconds or the number of instructions of a loop.
+class Meter {
+public:
+    Meter(const char* label) : mLabel(label), mCount() {}
+
+    void Start() {
+        if (gInstructions)
+            Counter().start();
+        else
+            mTimer.Start();
+    }
+
+    void Stop() {
+        if (gInstructions)
+            mCount = Counter().stop(mLabel);
+        else
+            mTimer.Stop();
+    }
+
+    double Get() {
+        return gInstructions ? mCount : mTimer.GetElapsedMilliseconds() * 1e6;
+    }
+
+    static const char* Unit() { return gInstructions ? "insns" : "ns"; }
+
+    // Instruction counts are deterministic so a single trial is enough.
+    static unsigned Trials() { return gInstructions ? 1 : kTrial; }
+
+    // Returns false if the instruction counts are only written to callgrind
+    // dumps and Get returns 0.
+    static bool HasResults() { return !gInstructions || Counter().available(); }
+
+    static instruction_counter& Counter() {
+        static instruction_counter counter;
+        return counter;
+    }
+
+private:
+    const char* mLabel;
+    Timer mTimer;
+    uint64_t mCount;
+};
+
 template <typename T>
 struct Traits {
 };
@@ -129,31 +184,37 @@ void BenchSequential(void(*f)(T, char*), const char* type, const char* fname, FI
     for (int digit = 1; digit <= Traits<T>::kMaxDigit; digit++) {
         T end = (digit == Traits<T>::kMaxDigit) ? std::numeric_limits<T>::max() : start * 10;
 
+        char label[64];
+        snprintf(label, sizeof(label), "%s_sequential,%s,%d", type, fname, digit);
         double duration = std::numeric_limits<double>::max();
-        for (unsigned trial = 0; trial < kTrial; trial++) {
+        for (unsigned trial = 0; trial < Meter::Trials(); trial++) {
             T v = start;
             T sign = 1;
-            Timer timer;
-            timer.Start();
+            Meter meter(label);
+            meter.Start();
             for (unsigned iteration = 0; iteration < kIterationPerDigit; iteration++) {
                 f(v * sign, buffer);
                 sign = Traits<T>::Negate(sign);
                 if (++v == end)
                     v = start;
             }
-            timer.Stop();
-            duration = std::min(duration, timer.GetElapsedMilliseconds());
+            meter.Stop();
+            duration = std::min(duration, meter.Get());
         }
 
-        duration *= 1e6 / kIterationPerDigit; // convert to nano second per operation
+        duration /= kIterationPerDigit; // per operation
 
         minDuration = std::min(minDuration, duration);
         maxDuration = std::max(maxDuration, duration);
-        fprintf(fp, "%s_sequential,%s,%d,%f\n", type, fname, digit, duration);
+        if (fp)
+            fprintf(fp, "%s_sequential,%s,%d,%f\n", type, fname, digit, duration);
         start = end;
     }
 
-    printf("[%8.3fns, %8.3fns]\n", minDuration, maxDuration);
+    if (Meter::HasResults())
+        printf("[%8.3f%s, %8.3f%s]\n", minDuration, Meter::Unit(), maxDuration, Meter::Unit());
+    else
+        puts("see callgrind dumps");
 }
 
 template <class T>
@@ -204,35 +265,103 @@ void BenchRandom(void(*f)(T, char*), const char* type, const char* fname, FILE*
     T* data = RandomData<T>::GetData();
     size_t n = RandomData<T>::kCount;
 
+    char label[64];
+    snprintf(label, sizeof(label), "%s_random,%s,0", type, fname);
     double duration = std::numeric_limits<double>::max();
-    for (unsigned trial = 0; trial < kTrial; trial++) {
-        Timer timer;
-        timer.Start();
+    for (unsigned trial = 0; trial < Meter::Trials(); trial++) {
+        Meter meter(label);
+        meter.Start();
 
         for (unsigned iteration = 0; iteration < kIterationForRandom; iteration++)
         for (size_t i = 0; i < n; i++)
             f(data[i], buffer);
 
-        timer.Stop();
-        duration = std::min(duration, timer.GetElapsedMilliseconds());
+        meter.Stop();
+        duration = std::min(duration, meter.Get());
+    }
+    duration /= kIterationForRandom * n; // per operation
+    if (fp)
+        fprintf(fp, "%s_random,%s,0,%f\n", type, fname, duration);
+
+    if (Meter::HasResults())
+        printf("%8.3f%s\n", duration, Meter::Unit());
+    else
+        puts("see callgrind dumps");
+}
+
+static void EvictCaches() {
+    static std::vector<char> scratch;
+    scratch.resize(gColdBytes);
+    volatile char* p = scratch.data();
+    for (size_t i = 0; i < gColdBytes; i += 64)
+        p[i] = p[i] + 1;
+}
+
+// Returns the median latency of single conversions with cold caches. The
+// median is used because individual samples include timer overhead and
+// noise.
+template <typename T>
+double ColdMedian(void(*f)(T, char*)) {
+    char buffer[Traits<T>::kBufferSize];
+    T* data = RandomData<T>::GetData();
+    size_t n = RandomData<T>::kCount;
+
+    std::vector<double> durations(kColdSamples);
+    for (unsigned i = 0; i < kColdSamples; i++) {
+        EvictCaches();
+        auto start = std::chrono::steady_clock::now();
+        f(data[i % n], buffer);
+        auto end = std::chrono::steady_clock::now();
+        durations[i] = std::chrono::duration<double, std::nano>(end - start).count();
     }
-    duration *= 1e6 / (kIterationForRandom * n); // convert to nano second per operation
-    fprintf(fp, "%s_random,%s,0,%f\n", type, fname, duration);
+    std::nth_element(durations.begin(), durations.begin() + kColdSamples / 2, durations.end());
+    return durations[kColdSamples / 2];
+}
+
+template <typename T>
+void NullConvert(T, char*) {
+}
+
+// Measures the latency of single conversions with cold caches subtracting
+// the latency of a null function which gives the timer overhead.
+template <typename T>
+void BenchCold(void(*f)(T, char*), const char* type, const char* fname, FILE* fp) {
+    printf("Benchmarking       cold %-20s ... ", fname);
+
+    static const double overhead = ColdMedian<T>(NullConvert<T>);
+    double duration = std::max(ColdMedian(f) - overhead, 0.0);
+    fprintf(fp, "%s_cold,%s,0,%f\n", type, fname, duration);
 
     printf("%8.3fns\n", duration);
 }
 
 template <typename T>
 void Bench(void(*f)(T, char*), const char* type, const char* fname, FILE* fp) {
+    if (gColdBytes) {
+        BenchCold(f, type, fname, fp);
+        return;
+    }
     BenchSequential(f, type, fname, fp);
     BenchRandom(f, type, fname, fp);
 }
 
 
 void BenchAll() {
-    // Try to write to /result path, where template.php exists
     FILE *fp;
-    if ((fp = fopen("../../result/template.php", "r")) != NULL) {
+    if (gInstructions) {
+        // Instruction counts don't fit the result template so write them
+        // to the current directory. Under callgrind they are only in the
+        // dumps so no file is written.
+        fp = NULL;
+        if (Meter::HasResults()) {
+            fp = fopen("instructions_" RESULT_FILENAME, "w");
+            fprintf(fp, "Type,Function,Digit,Instructions\n");
+        }
+    }
+    else if (gColdBytes)
+        fp = fopen("cold_" RESULT_FILENAME, "w");
+    // Try to write to /result path, where template.php exists
+    else if ((fp = fopen("../../result/template.php", "r")) != NULL) {
         fclose(fp);
         fp = fopen("../../result/" RESULT_FILENAME, "w");
     }
@@ -243,7 +372,8 @@ void BenchAll() {
     else
         fp = fopen(RESULT_FILENAME, "w");
 
-    fprintf(fp, "Type,Function,Digit,Time(ns)\n");
+    if (!gInstructions)
+        fprintf(fp, "Type,Function,Digit,Time(ns)\n");
 
     const TestList& tests = TestManager::Instance().GetTests();
 
@@ -266,10 +396,45 @@ void BenchAll() {
     for (TestList::const_iterator itr = tests.begin(); itr != tests.end(); ++itr)
         Bench((*itr)->i64toa, "i64toa", (*itr)->fname, fp);
 
-    fclose(fp);
+    if (fp)
+        fclose(fp);
 }
 
-int main() {
+// Usage: itoa-benchmark [--instructions] [--cold[=<bytes>]]
+//
+// --instructions: measure the number of instructions per operation instead
+// of time. Falls back to callgrind dumps if hardware counters are not
+// available, see instruction-counter.h.
+//
+// --cold: measure the latency of single conversions after writing a scratch
+// buffer of the given size (default 4 MiB) to evict lookup tables from L1/L2
+// as happens when formatting is interleaved with other work.
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--instructions") == 0)
+            gInstructions = true;
+        else if (strcmp(argv[i], "--cold") == 0)
+            gColdBytes = kDefaultColdBytes;
+        else if (strncmp(argv[i], "--cold=", 7) == 0)
+            gColdBytes = strtoul(argv[i] + 7, NULL, 10);
+        else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (gInstructions && gColdBytes) {
+        fprintf(stderr, "--instructions and --cold are mutually exclusive\n");
+        return 1;
+    }
+    if (gInstructions) {
+        const instruction_counter& counter = Meter::Counter();
+        if (!counter.available() && !counter.callgrind()) {
+            fprintf(stderr, "Instruction counters are not available; "
+                    "run under valgrind --tool=callgrind --collect-atstart=no\n");
+            return 1;
+        }
+    }
+
     // sort tests
     TestList& tests = TestManager::Instance().GetTests();
     std::sort(tests.begin(), tests.end(),
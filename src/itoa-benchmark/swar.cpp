@@ -0,0 +1,24 @@
+#include <stdint.h>
+#include "itoa_swar.h"
+#include "test.h"
+
+// Converting 8 digits at once in a 64-bit register with multiply-shift
+// arithmetic, no lookup tables and no SIMD instructions.
+
+void u32toa_swar(uint32_t value, char* buffer) {
+    *itoa_swar::u32toa(value, buffer) = '\0';
+}
+
+void i32toa_swar(int32_t value, char* buffer) {
+    *itoa_swar::i32toa(value, buffer) = '\0';
+}
+
+void u64toa_swar(uint64_t value, char* buffer) {
+    *itoa_swar::u64toa(value, buffer) = '\0';
+}
+
+void i64toa_swar(int64_t value, char* buffer) {
+    *itoa_swar::i64toa(value, buffer) = '\0';
+}
+
+REGISTER_TEST(swar);
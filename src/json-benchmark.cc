@@ -0,0 +1,296 @@
+// A benchmark of serializing arrays of records with integers, doubles,
+// escaped strings and nested arrays to JSON. Reports the output throughput
+// and the number of allocations per serialization.
+//
+// Copyright (c) 2019 - present, Victor Zverovich
+// All rights reserved.
+
+#include <benchmark/benchmark.h>
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "dtoa_milo.h"
+
+// Kernels from itoa-benchmark.
+void i32toa_jeaiii(int32_t i, char* b);
+void i64toa_branchlut(int64_t value, char* buffer);
+
+// The number of allocations counted by the replaced operator new and
+// operator new[].
+size_t num_allocations = 0;
+
+inline void* allocate(size_t size) {
+  ++num_allocations;
+  if (void* p = std::malloc(size)) return p;
+  throw std::bad_alloc();
+}
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+struct record {
+  int32_t id;
+  int64_t created;
+  std::string name;
+  double score;
+  std::vector<std::string> tags;
+  std::vector<int32_t> values;
+};
+
+struct Input {
+  std::vector<record> records;
+  size_t max_size = 0;  // An upper bound of the output size.
+  std::string expected;
+};
+
+std::string format_fmt_back_inserter(const std::vector<record>& records);
+
+// Returns a bound of the JSON size of r: 6 bytes per string character for
+// \u00XX escapes, 11 per int32, 20 per int64, 24 per double and some room
+// for the keys and punctuation.
+size_t max_size(const record& r) {
+  size_t size = 100 + 11 + 20 + 24 + r.name.size() * 6;
+  for (const auto& tag : r.tags) size += tag.size() * 6 + 3;
+  return size + r.values.size() * 12;
+}
+
+// Returns n records. The scores are odd multiples of 1/16 with at most 11
+// significant digits so they are exactly representable and all methods,
+// including printf with %.17g, give the same shortest output.
+const Input& get_input(size_t n) {
+  static std::map<size_t, Input> inputs;
+  auto it = inputs.find(n);
+  if (it != inputs.end()) return it->second;
+  auto& input = inputs[n];
+  std::mt19937 gen;
+  const char* words[] = {"alpha", "beta", "gamma", "delta", "quote\"d",
+                         "back\\slash", "new\nline", "tab\there", "bell\a"};
+  auto random_string = [&](int num_words) {
+    std::string s = words[gen() % 9];
+    for (int i = 1; i < num_words; ++i) (s += ' ') += words[gen() % 9];
+    return s;
+  };
+  input.records.resize(n);
+  for (auto& r : input.records) {
+    r.id = static_cast<int32_t>(gen() >> (gen() % 32));
+    r.created = 1'700'000'000'000 + gen() % 1'000'000'000;
+    r.name = random_string(gen() % 4 + 1);
+    r.score = static_cast<int>(gen() % 2'000'000) - 1'000'000 +
+              static_cast<int>(gen() % 8 * 2 + 1) / 16.0;
+    r.tags.resize(gen() % 4);
+    for (auto& tag : r.tags) tag = random_string(1);
+    r.values.resize(gen() % 8);
+    for (auto& value : r.values) value = static_cast<int32_t>(gen()) >> 8;
+    input.max_size += max_size(r) + 1;
+  }
+  input.max_size += 2;
+  input.expected = format_fmt_back_inserter(input.records);
+  return input;
+}
+
+// Writes s as a JSON string copying runs of characters that don't need
+// escaping at once.
+template <typename OutputIt>
+OutputIt write_string(OutputIt out, const std::string& s) {
+  *out++ = '"';
+  const char* run_begin = s.data();
+  const char* end = s.data() + s.size();
+  for (const char* p = run_begin; p != end; ++p) {
+    auto c = static_cast<unsigned char>(*p);
+    if (c >= 0x20 && c != '"' && c != '\\') continue;
+    out = std::copy(run_begin, p, out);
+    run_begin = p + 1;
+    *out++ = '\\';
+    switch (c) {
+    case '"':
+    case '\\':
+      *out++ = static_cast<char>(c);
+      break;
+    case '\n':
+      *out++ = 'n';
+      break;
+    case '\t':
+      *out++ = 't';
+      break;
+    default:
+      const char* hex = "0123456789abcdef";
+      const char escape[] = {'u', '0', '0', hex[c >> 4], hex[c & 0xf]};
+      out = std::copy(escape, escape + sizeof(escape), out);
+      break;
+    }
+  }
+  out = std::copy(run_begin, end, out);
+  *out++ = '"';
+  return out;
+}
+
+// Writes records with fmt::format_to using the output iterator out.
+template <typename OutputIt>
+OutputIt write_fmt(OutputIt out, const std::vector<record>& records) {
+  *out++ = '[';
+  for (const auto& r : records) {
+    if (&r != records.data()) *out++ = ',';
+    out = fmt::format_to(out, "{{\"id\":{},\"created\":{},\"name\":", r.id,
+                         r.created);
+    out = write_string(out, r.name);
+    out = fmt::format_to(out, ",\"score\":{},\"tags\":[", r.score);
+    for (const auto& tag : r.tags) {
+      if (&tag != r.tags.data()) *out++ = ',';
+      out = write_string(out, tag);
+    }
+    out = fmt::format_to(out, "],\"values\":[{}]}}",
+                         fmt::join(r.values, ","));
+  }
+  *out++ = ']';
+  return out;
+}
+
+std::string format_fmt_back_inserter(const std::vector<record>& records) {
+  fmt::memory_buffer buffer;
+  write_fmt(std::back_inserter(buffer), records);
+  return fmt::to_string(buffer);
+}
+
+// Runs the serialization returning a pointer past the end of the output in a
+// buffer of input.max_size bytes allocated once and reused.
+template <typename F> void run(benchmark::State& state, F serialize) {
+  const auto& input = get_input(static_cast<size_t>(state.range(0)));
+  auto buffer = std::unique_ptr<char[]>(new char[input.max_size]);
+  size_t size = 0, allocations = num_allocations;
+  for (auto s : state) {
+    size += serialize(input.records, buffer.get()) - buffer.get();
+    benchmark::DoNotOptimize(buffer.get());
+  }
+  allocations = num_allocations - allocations;
+  auto end = serialize(input.records, buffer.get());
+  if (std::string(buffer.get(), end) != input.expected)
+    throw std::logic_error("invalid output");
+  state.SetBytesProcessed(size);
+  state.counters["allocations"] =
+      benchmark::Counter(allocations, benchmark::Counter::kAvgIterations);
+}
+
+void size_args(benchmark::internal::Benchmark* b) {
+  b->ArgName("records")->Arg(16)->Arg(512)->Arg(16 << 10);
+}
+
+// Serializes into a new memory_buffer that grows as needed instead of a
+// buffer of the precomputed size.
+void fmt_back_inserter(benchmark::State& state) {
+  const auto& input = get_input(static_cast<size_t>(state.range(0)));
+  size_t size = 0, allocations = num_allocations;
+  for (auto s : state) {
+    fmt::memory_buffer buffer;
+    write_fmt(std::back_inserter(buffer), input.records);
+    size += buffer.size();
+    benchmark::DoNotOptimize(buffer.data());
+  }
+  allocations = num_allocations - allocations;
+  if (format_fmt_back_inserter(input.records) != input.expected)
+    throw std::logic_error("invalid output");
+  state.SetBytesProcessed(size);
+  state.counters["allocations"] =
+      benchmark::Counter(allocations, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(fmt_back_inserter)->Apply(size_args);
+
+void fmt_char_ptr(benchmark::State& state) {
+  run(state, [](const std::vector<record>& records, char* out) {
+    return write_fmt(out, records);
+  });
+}
+BENCHMARK(fmt_char_ptr)->Apply(size_args);
+
+// The strings are escaped with write_string since printf has no escaping.
+void snprintf_chain(benchmark::State& state) {
+  auto bound = get_input(static_cast<size_t>(state.range(0))).max_size;
+  run(state, [bound](const std::vector<record>& records, char* out) {
+    char* end = out + bound;
+    *out++ = '[';
+    for (const auto& r : records) {
+      if (&r != records.data()) *out++ = ',';
+      out += std::snprintf(out, end - out,
+                           "{\"id\":%d,\"created\":%lld,\"name\":", r.id,
+                           static_cast<long long>(r.created));
+      out = write_string(out, r.name);
+      out += std::snprintf(out, end - out, ",\"score\":%.17g,\"tags\":[",
+                           r.score);
+      for (const auto& tag : r.tags) {
+        if (&tag != r.tags.data()) *out++ = ',';
+        out = write_string(out, tag);
+      }
+      out += std::snprintf(out, end - out, "],\"values\":[");
+      for (const auto& value : r.values) {
+        const char* format = &value != r.values.data() ? ",%d" : "%d";
+        out += std::snprintf(out, end - out, format, value);
+      }
+      *out++ = ']';
+      *out++ = '}';
+    }
+    *out++ = ']';
+    return out;
+  });
+}
+BENCHMARK(snprintf_chain)->Apply(size_args);
+
+// Copies a string literal without the terminating null.
+template <size_t N> inline char* write_literal(char* out, const char (&s)[N]) {
+  std::memcpy(out, s, N - 1);
+  return out + N - 1;
+}
+
+// A handwritten writer that uses jeaiii for int32, branchlut for int64 and
+// dtoa_milo for doubles.
+char* write_handwritten(const std::vector<record>& records, char* out) {
+  *out++ = '[';
+  for (const auto& r : records) {
+    if (&r != records.data()) *out++ = ',';
+    out = write_literal(out, "{\"id\":");
+    i32toa_jeaiii(r.id, out);
+    out += std::strlen(out);
+    out = write_literal(out, ",\"created\":");
+    i64toa_branchlut(r.created, out);
+    out += std::strlen(out);
+    out = write_literal(out, ",\"name\":");
+    out = write_string(out, r.name);
+    out = write_literal(out, ",\"score\":");
+    dtoa_milo(r.score, out);
+    out += std::strlen(out);
+    out = write_literal(out, ",\"tags\":[");
+    for (const auto& tag : r.tags) {
+      if (&tag != r.tags.data()) *out++ = ',';
+      out = write_string(out, tag);
+    }
+    out = write_literal(out, "],\"values\":[");
+    for (const auto& value : r.values) {
+      if (&value != r.values.data()) *out++ = ',';
+      i32toa_jeaiii(value, out);
+      out += std::strlen(out);
+    }
+    out = write_literal(out, "]}");
+  }
+  *out++ = ']';
+  return out;
+}
+
+void handwritten(benchmark::State& state) { run(state, write_handwritten); }
+BENCHMARK(handwritten)->Apply(size_args);
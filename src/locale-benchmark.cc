@@ -102,5 +102,3 @@ void format_locale(benchmark::State& state) {
   finalize(state, result);
 }
 BENCHMARK(format_locale);
-
-BENCHMARK_MAIN();
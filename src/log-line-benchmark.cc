@@ -0,0 +1,244 @@
+// An end-to-end benchmark of formatting full log lines consisting of a
+// timestamp, a level, a thread ID, a source location and a message with 3 or
+// 5 arguments into one reusable buffer which is then written to a sink.
+//
+// Copyright (c) 2019 - present, Victor Zverovich
+// All rights reserved.
+
+#include <benchmark/benchmark.h>
+#include <fmt/compile.h>
+#include <fmt/os.h>
+
+#include <cstdarg>
+#include <cstdio>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#define STB_SPRINTF_IMPLEMENTATION
+#include "stb_sprintf.h"
+#include "tinyformat.h"
+
+struct log_record {
+  int year, month, day, hour, minute, second, microsecond;
+  const char* level;
+  unsigned thread_id;
+  const char* file;
+  int line;
+  // The message is either a request with 5 arguments or a cache statistic
+  // with 3 arguments.
+  bool is_request;
+  const char* name;  // HTTP method or cache name.
+  const char* path;
+  int id;
+  double value;
+  int status;
+};
+
+const std::vector<log_record>& get_records() {
+  static auto records = [] {
+    const char* levels[] = {"trace", "debug", "info", "warning", "error"};
+    const char* files[] = {"src/server.cc", "src/cache/lru-cache.h",
+                           "src/http/request-handler.cc"};
+    const char* methods[] = {"GET", "POST", "DELETE"};
+    const char* paths[] = {"/", "/api/v1/users", "/api/v1/users/profile/photo",
+                           "/static/app.js"};
+    const char* caches[] = {"sessions", "templates", "dns"};
+    std::vector<log_record> records(100'000);
+    std::mt19937 gen;
+    int64_t microseconds = 0;
+    for (auto& r : records) {
+      microseconds += gen() % 1000;
+      r.year = 2023;
+      r.month = 11;
+      r.day = 14;
+      r.hour = 22 + static_cast<int>(microseconds / 3'600'000'000);
+      r.minute = microseconds / 60'000'000 % 60;
+      r.second = microseconds / 1'000'000 % 60;
+      r.microsecond = microseconds % 1'000'000;
+      r.level = levels[gen() % 5];
+      r.thread_id = 10000 + gen() % 50000;
+      r.file = files[gen() % 3];
+      r.line = gen() % 2000 + 1;
+      r.is_request = gen() % 4 != 0;
+      r.name = r.is_request ? methods[gen() % 3] : caches[gen() % 3];
+      r.path = paths[gen() % 4];
+      r.id = gen() % 1'000'000;
+      // No rounding is needed to print the value with 2 digits after the
+      // point and value / 100 with 4, so that stb_sprintf which rounds ties
+      // differently from the others produces the same output.
+      r.value = (gen() % 10'000) / 100.0;
+      r.status = r.is_request ? 200 + gen() % 4 * 100 : 0;
+    }
+    return records;
+  }();
+  return records;
+}
+
+#define PREFIX_PRINTF "%04d-%02d-%02d %02d:%02d:%02d.%06d [%s] [%u] %s:%d "
+#define REQUEST_PRINTF "request %s %s user=%d took %.2f ms status=%d\n"
+#define CACHE_PRINTF "cache %s hit ratio %.4f entries=%d\n"
+
+#define PREFIX_FMT "{:04}-{:02}-{:02} {:02}:{:02}:{:02}.{:06} [{}] [{}] {}:{} "
+#define REQUEST_FMT "request {} {} user={} took {:.2f} ms status={}\n"
+#define CACHE_FMT "cache {} hit ratio {:.4f} entries={}\n"
+
+#define PREFIX_ARGS(r)                                                    \
+  r.year, r.month, r.day, r.hour, r.minute, r.second, r.microsecond,      \
+      r.level, r.thread_id, r.file, r.line
+#define REQUEST_ARGS(r) r.name, r.path, r.id, r.value, r.status
+#define CACHE_ARGS(r) r.name, r.value / 100, r.id
+
+// Formatters return a view of the line valid until the next call.
+
+struct fmt_memory_buffer {
+  fmt::memory_buffer buffer;
+
+  fmt::string_view format(const log_record& r) {
+    buffer.clear();
+    auto out = std::back_inserter(buffer);
+    if (r.is_request) {
+      fmt::format_to(out, PREFIX_FMT REQUEST_FMT, PREFIX_ARGS(r),
+                     REQUEST_ARGS(r));
+    } else {
+      fmt::format_to(out, PREFIX_FMT CACHE_FMT, PREFIX_ARGS(r), CACHE_ARGS(r));
+    }
+    return {buffer.data(), buffer.size()};
+  }
+};
+
+struct fmt_compile {
+  fmt::memory_buffer buffer;
+
+  fmt::string_view format(const log_record& r) {
+    buffer.clear();
+    auto out = std::back_inserter(buffer);
+    if (r.is_request) {
+      fmt::format_to(out, FMT_COMPILE(PREFIX_FMT REQUEST_FMT), PREFIX_ARGS(r),
+                     REQUEST_ARGS(r));
+    } else {
+      fmt::format_to(out, FMT_COMPILE(PREFIX_FMT CACHE_FMT), PREFIX_ARGS(r),
+                     CACHE_ARGS(r));
+    }
+    return {buffer.data(), buffer.size()};
+  }
+};
+
+struct snprintf_buffer {
+  char buffer[512];
+
+  fmt::string_view format(const log_record& r) {
+    int size = r.is_request
+                   ? std::snprintf(buffer, sizeof(buffer),
+                                   PREFIX_PRINTF REQUEST_PRINTF,
+                                   PREFIX_ARGS(r), REQUEST_ARGS(r))
+                   : std::snprintf(buffer, sizeof(buffer),
+                                   PREFIX_PRINTF CACHE_PRINTF, PREFIX_ARGS(r),
+                                   CACHE_ARGS(r));
+    return {buffer, static_cast<size_t>(size)};
+  }
+};
+
+// Formats with stbsp_vsprintfcb appending each chunk to a reusable string.
+struct stb_vsprintfcb {
+  std::string buffer;
+  char chunk[STB_SPRINTF_MIN];
+
+  static char* append(char* buf, void* user, int len) {
+    static_cast<std::string*>(user)->append(buf, len);
+    return buf;
+  }
+
+  void vformat(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    stbsp_vsprintfcb(append, &buffer, chunk, format, args);
+    va_end(args);
+  }
+
+  fmt::string_view format(const log_record& r) {
+    buffer.clear();
+    if (r.is_request)
+      vformat(PREFIX_PRINTF REQUEST_PRINTF, PREFIX_ARGS(r), REQUEST_ARGS(r));
+    else
+      vformat(PREFIX_PRINTF CACHE_PRINTF, PREFIX_ARGS(r), CACHE_ARGS(r));
+    return buffer;
+  }
+};
+
+struct tfm_format {
+  std::ostringstream os;
+  std::string line;
+
+  fmt::string_view format(const log_record& r) {
+    os.str(std::string());
+    if (r.is_request)
+      tfm::format(os, PREFIX_PRINTF REQUEST_PRINTF, PREFIX_ARGS(r),
+                  REQUEST_ARGS(r));
+    else
+      tfm::format(os, PREFIX_PRINTF CACHE_PRINTF, PREFIX_ARGS(r),
+                  CACHE_ARGS(r));
+    line = os.str();
+    return line;
+  }
+};
+
+// The sinks from file-benchmark: none (the line stays in memory), stdio and
+// fmt::output_file.
+enum sink_type { memory, stdio, fmt_output_file };
+
+const char* test_file = "/tmp/log-line-test";
+
+template <typename Formatter> void run(benchmark::State& state) {
+  const auto& records = get_records();
+  auto type = static_cast<sink_type>(state.range(0));
+  FILE* file = type == stdio ? std::fopen(test_file, "wb") : nullptr;
+  auto output_file = type == fmt_output_file
+                         ? std::make_unique<fmt::ostream>(
+                               fmt::output_file(test_file))
+                         : nullptr;
+  Formatter formatter;
+  size_t size = 0;
+  for (auto s : state) {
+    for (const auto& r : records) {
+      auto line = formatter.format(r);
+      switch (type) {
+      case memory:
+        benchmark::DoNotOptimize(line.data());
+        break;
+      case stdio:
+        std::fwrite(line.data(), 1, line.size(), file);
+        break;
+      case fmt_output_file:
+        output_file->print("{}", line);
+        break;
+      }
+      size += line.size();
+    }
+  }
+  if (file) std::fclose(file);
+  output_file.reset();
+  std::remove(test_file);
+  // Check the lines of all methods against snprintf.
+  snprintf_buffer reference;
+  for (const auto& r : records) {
+    if (formatter.format(r) != reference.format(r))
+      throw std::logic_error("invalid output");
+  }
+  state.SetItemsProcessed(state.iterations() * records.size());
+  state.SetBytesProcessed(size);
+}
+
+void sink_args(benchmark::internal::Benchmark* b) {
+  b->ArgName("sink")->DenseRange(memory, fmt_output_file);
+}
+
+BENCHMARK_TEMPLATE(run, fmt_memory_buffer)->Apply(sink_args);
+BENCHMARK_TEMPLATE(run, fmt_compile)->Apply(sink_args);
+BENCHMARK_TEMPLATE(run, snprintf_buffer)->Apply(sink_args);
+BENCHMARK_TEMPLATE(run, stb_vsprintfcb)->Apply(sink_args);
+BENCHMARK_TEMPLATE(run, tfm_format)->Apply(sink_args);
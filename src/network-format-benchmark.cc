@@ -0,0 +1,422 @@
+// A benchmark of formatting IPv4 and IPv6 addresses and UUIDs as in access
+// logs.
+//
+// Copyright (c) 2019 - present, Victor Zverovich
+// All rights reserved.
+
+#include <arpa/inet.h>
+#include <benchmark/benchmark.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bounded-int.h"
+#include "hex.h"
+
+// Addresses are stored in network byte order as in in_addr and in6_addr.
+struct ipv4_address {
+  uint8_t bytes[4];
+};
+
+struct ipv6_address {
+  uint8_t bytes[16];
+
+  unsigned group(int i) const { return bytes[i * 2] << 8 | bytes[i * 2 + 1]; }
+};
+
+struct uuid {
+  uint8_t bytes[16];
+};
+
+constexpr size_t num_values = 100'000;
+
+const std::vector<ipv4_address>& ipv4_data() {
+  static auto data = [] {
+    std::vector<ipv4_address> data(num_values);
+    std::mt19937 gen;
+    // Octets with 1, 2 and 3 digits are equally likely.
+    const unsigned limits[] = {10, 100, 256};
+    for (auto& a : data) {
+      for (auto& b : a.bytes) b = gen() % limits[gen() % 3];
+    }
+    return data;
+  }();
+  return data;
+}
+
+const std::vector<ipv6_address>& ipv6_data() {
+  static auto data = [] {
+    std::vector<ipv6_address> data(num_values);
+    std::mt19937 gen;
+    for (auto& a : data) {
+      // Zero groups are frequent to exercise the "::" compression. Addresses
+      // starting with 5 zero groups are avoided because inet_ntop formats
+      // some of them with an embedded IPv4 address.
+      do {
+        for (int i = 0; i < 16; i += 2) {
+          unsigned shift = gen() % 16 + 16;
+          unsigned group = gen() % 3 == 0 ? 0 : gen() >> shift;
+          a.bytes[i] = static_cast<uint8_t>(group >> 8);
+          a.bytes[i + 1] = static_cast<uint8_t>(group);
+        }
+      } while (std::all_of(a.bytes, a.bytes + 10, [](uint8_t b) {
+        return b == 0;
+      }));
+    }
+    return data;
+  }();
+  return data;
+}
+
+const std::vector<uuid>& uuid_data() {
+  static auto data = [] {
+    std::vector<uuid> data(num_values);
+    std::mt19937 gen;
+    for (auto& u : data) {
+      for (auto& b : u.bytes) b = static_cast<uint8_t>(gen());
+    }
+    return data;
+  }();
+  return data;
+}
+
+// Writes an IPv4 address using a table of all octets with the length in the
+// last byte of each entry. Each octet is copied with a single 4-byte store
+// and followed by a dot which is dropped at the end so there are no branches.
+inline char* format_ipv4(char* out, const ipv4_address& a) {
+  for (auto b : a.bytes) {
+    const char* entry = bounded::table<255>.entries[b];
+    std::memcpy(out, entry, 4);
+    out += entry[3];
+    *out++ = '.';
+  }
+  return out - 1;
+}
+
+// Returns the index of the first group of the longest run of at least two
+// zero groups, the first one if there are several, or -1 if there is none
+// as specified in RFC 5952.
+inline int find_zero_run(const ipv6_address& a, int& run_end) {
+  int begin = -1, size = 1;
+  for (int i = 0; i < 8;) {
+    if (a.group(i) != 0) {
+      ++i;
+      continue;
+    }
+    int j = i + 1;
+    while (j < 8 && a.group(j) == 0) ++j;
+    if (j - i > size) {
+      begin = i;
+      size = j - i;
+    }
+    i = j;
+  }
+  run_end = begin + size;
+  return begin;
+}
+
+// Writes an IPv6 address in the RFC 5952 form calling write_group to write
+// each group.
+template <typename F>
+inline char* format_ipv6(char* out, const ipv6_address& a, F write_group) {
+  int run_end = 0;
+  int run_begin = find_zero_run(a, run_end);
+  for (int i = 0; i < 8;) {
+    if (i == run_begin) {
+      *out++ = ':';
+      *out++ = ':';
+      i = run_end;
+      continue;
+    }
+    if (i != 0 && i != run_end) *out++ = ':';
+    out = write_group(out, a.group(i));
+    ++i;
+  }
+  return out;
+}
+
+// Writes a group in hex without leading zeros with a single 4-byte store
+// by shifting out the leading zero digits. Writes up to 4 bytes so out must
+// have room for that many characters. Assumes a little-endian target.
+inline char* write_group(char* out, unsigned group) {
+  char digits[4];
+  std::memcpy(digits, hex_digits.entries[group >> 8], 2);
+  std::memcpy(digits + 2, hex_digits.entries[group & 0xff], 2);
+  int num_digits = (35 - __builtin_clz(group | 1)) / 4;
+  uint32_t value;
+  std::memcpy(&value, digits, 4);
+  value >>= (4 - num_digits) * 8;
+  std::memcpy(out, &value, 4);
+  return out + num_digits;
+}
+
+inline char* format_ipv6(char* out, const ipv6_address& a) {
+  return format_ipv6(out, a, write_group);
+}
+
+// Writes a UUID in the 8-4-4-4-12 form with the two-digit table.
+inline char* format_uuid(char* out, const uuid& u) {
+  for (int i = 0; i < 16; ++i) {
+    if (i == 4 || i == 6 || i == 8 || i == 10) *out++ = '-';
+    std::memcpy(out, hex_digits.entries[u.bytes[i]], 2);
+    out += 2;
+  }
+  return out;
+}
+
+#ifdef HAVE_SIMD
+// pshufb indices that insert dashes into the 32 digits of a UUID. The output
+// chunk k takes digits from lo with indices[k][0] and from hi with
+// indices[k][1]; -1 gives a zero byte. Only the first 4 bytes of the last
+// chunk are used.
+struct uuid_table {
+  int8_t indices[3][2][16];
+  int8_t dashes[3][16];
+
+  constexpr uuid_table() : indices(), dashes() {
+    for (int i = 0, digit = 0; i < 36; ++i) {
+      int chunk = i / 16, pos = i % 16;
+      bool is_dash = i == 8 || i == 13 || i == 18 || i == 23;
+      dashes[chunk][pos] = is_dash ? '-' : 0;
+      indices[chunk][0][pos] = !is_dash && digit < 16 ? digit : -1;
+      indices[chunk][1][pos] = !is_dash && digit >= 16 ? digit - 16 : -1;
+      if (!is_dash) ++digit;
+    }
+  }
+};
+
+alignas(16) inline constexpr uuid_table uuid_layout{};
+
+__attribute__((target("ssse3"))) char* format_uuid_ssse3(char* out,
+                                                         const uuid& u) {
+  __m128i lo, hi;
+  encode16(u.bytes, lo, hi);
+  __m128i chunks[3];
+  for (int k = 0; k < 3; ++k) {
+    auto load = [](const int8_t* p) {
+      return _mm_load_si128(reinterpret_cast<const __m128i*>(p));
+    };
+    chunks[k] = _mm_or_si128(
+        _mm_or_si128(_mm_shuffle_epi8(lo, load(uuid_layout.indices[k][0])),
+                     _mm_shuffle_epi8(hi, load(uuid_layout.indices[k][1]))),
+        load(uuid_layout.dashes[k]));
+  }
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out), chunks[0]);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), chunks[1]);
+  int last = _mm_cvtsi128_si32(chunks[2]);
+  std::memcpy(out + 32, &last, 4);
+  return out + 36;
+}
+#endif
+
+// fmt formatters that plug the kernels into fmt::format.
+template <> struct fmt::formatter<ipv4_address> {
+  constexpr auto parse(format_parse_context& ctx) { return ctx.begin(); }
+
+  template <typename FormatContext>
+  auto format(const ipv4_address& a, FormatContext& ctx) const {
+    char buffer[16];
+    return std::copy(buffer, format_ipv4(buffer, a), ctx.out());
+  }
+};
+
+template <> struct fmt::formatter<ipv6_address> {
+  constexpr auto parse(format_parse_context& ctx) { return ctx.begin(); }
+
+  template <typename FormatContext>
+  auto format(const ipv6_address& a, FormatContext& ctx) const {
+    char buffer[48];
+    return std::copy(buffer, format_ipv6(buffer, a), ctx.out());
+  }
+};
+
+template <> struct fmt::formatter<uuid> {
+  constexpr auto parse(format_parse_context& ctx) { return ctx.begin(); }
+
+  template <typename FormatContext>
+  auto format(const uuid& u, FormatContext& ctx) const {
+    char buffer[36];
+    return std::copy(buffer, format_uuid(buffer, u), ctx.out());
+  }
+};
+
+// Returns the output of format for all values separated by newlines.
+template <typename T, typename F>
+std::string format_all(const std::vector<T>& values, F format) {
+  std::string result;
+  for (const auto& value : values) {
+    char buffer[64];
+    result.append(buffer, format(buffer, value));
+    result += '\n';
+  }
+  return result;
+}
+
+// Formats all values and checks the output against the reference which is
+// inet_ntop for addresses and snprintf for UUIDs.
+template <typename T, typename F>
+void run(benchmark::State& state, const std::vector<T>& values, F format,
+         const std::string& expected) {
+  size_t size = 0;
+  for (auto s : state) {
+    for (const auto& value : values) {
+      char buffer[64];
+      size += format(buffer, value) - buffer;
+      benchmark::DoNotOptimize(buffer);
+    }
+  }
+  benchmark::DoNotOptimize(size);
+  if (format_all(values, format) != expected)
+    throw std::logic_error("invalid output");
+  state.SetItemsProcessed(state.iterations() * values.size());
+}
+
+char* inet_ntop4(char* out, const ipv4_address& a) {
+  inet_ntop(AF_INET, a.bytes, out, INET_ADDRSTRLEN);
+  return out + std::strlen(out);
+}
+
+char* inet_ntop6(char* out, const ipv6_address& a) {
+  inet_ntop(AF_INET6, a.bytes, out, INET6_ADDRSTRLEN);
+  return out + std::strlen(out);
+}
+
+char* sprintf_uuid(char* out, const uuid& u) {
+  const uint8_t* b = u.bytes;
+  return out + std::sprintf(out,
+                            "%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-"
+                            "%02x%02x%02x%02x%02x%02x",
+                            b[0], b[1], b[2], b[3], b[4], b[5], b[6], b[7],
+                            b[8], b[9], b[10], b[11], b[12], b[13], b[14],
+                            b[15]);
+}
+
+template <typename F> void run_ipv4(benchmark::State& state, F format) {
+  static const std::string expected = format_all(ipv4_data(), inet_ntop4);
+  run(state, ipv4_data(), format, expected);
+}
+
+template <typename F> void run_ipv6(benchmark::State& state, F format) {
+  static const std::string expected = format_all(ipv6_data(), inet_ntop6);
+  run(state, ipv6_data(), format, expected);
+}
+
+template <typename F> void run_uuid(benchmark::State& state, F format) {
+  static const std::string expected = format_all(uuid_data(), sprintf_uuid);
+  run(state, uuid_data(), format, expected);
+}
+
+void ipv4_fmt_format_to(benchmark::State& state) {
+  run_ipv4(state, [](char* out, const ipv4_address& a) {
+    const uint8_t* b = a.bytes;
+    return fmt::format_to(out, "{}.{}.{}.{}", b[0], b[1], b[2], b[3]);
+  });
+}
+BENCHMARK(ipv4_fmt_format_to);
+
+void ipv4_sprintf(benchmark::State& state) {
+  run_ipv4(state, [](char* out, const ipv4_address& a) {
+    const uint8_t* b = a.bytes;
+    return out + std::sprintf(out, "%u.%u.%u.%u", b[0], b[1], b[2], b[3]);
+  });
+}
+BENCHMARK(ipv4_sprintf);
+
+void ipv4_inet_ntop(benchmark::State& state) { run_ipv4(state, inet_ntop4); }
+BENCHMARK(ipv4_inet_ntop);
+
+void ipv4_kernel(benchmark::State& state) {
+  run_ipv4(state, [](char* out, const ipv4_address& a) {
+    return format_ipv4(out, a);
+  });
+}
+BENCHMARK(ipv4_kernel);
+
+void ipv4_fmt_formatter(benchmark::State& state) {
+  run_ipv4(state, [](char* out, const ipv4_address& a) {
+    return fmt::format_to(out, "{}", a);
+  });
+}
+BENCHMARK(ipv4_fmt_formatter);
+
+void ipv6_fmt_format_to(benchmark::State& state) {
+  run_ipv6(state, [](char* out, const ipv6_address& a) {
+    return format_ipv6(out, a, [](char* out, unsigned group) {
+      return fmt::format_to(out, "{:x}", group);
+    });
+  });
+}
+BENCHMARK(ipv6_fmt_format_to);
+
+void ipv6_sprintf(benchmark::State& state) {
+  run_ipv6(state, [](char* out, const ipv6_address& a) {
+    return format_ipv6(out, a, [](char* out, unsigned group) {
+      return out + std::sprintf(out, "%x", group);
+    });
+  });
+}
+BENCHMARK(ipv6_sprintf);
+
+void ipv6_inet_ntop(benchmark::State& state) { run_ipv6(state, inet_ntop6); }
+BENCHMARK(ipv6_inet_ntop);
+
+void ipv6_kernel(benchmark::State& state) {
+  run_ipv6(state, [](char* out, const ipv6_address& a) {
+    return format_ipv6(out, a);
+  });
+}
+BENCHMARK(ipv6_kernel);
+
+void ipv6_fmt_formatter(benchmark::State& state) {
+  run_ipv6(state, [](char* out, const ipv6_address& a) {
+    return fmt::format_to(out, "{}", a);
+  });
+}
+BENCHMARK(ipv6_fmt_formatter);
+
+void uuid_fmt_format_to(benchmark::State& state) {
+  run_uuid(state, [](char* out, const uuid& u) {
+    const uint8_t* b = u.bytes;
+    return fmt::format_to(
+        out, "{:02x}{:02x}{:02x}{:02x}-{:02x}{:02x}-{:02x}{:02x}-{:02x}{:02x}-"
+        "{:02x}{:02x}{:02x}{:02x}{:02x}{:02x}",
+        b[0], b[1], b[2], b[3], b[4], b[5], b[6], b[7], b[8], b[9], b[10],
+        b[11], b[12], b[13], b[14], b[15]);
+  });
+}
+BENCHMARK(uuid_fmt_format_to);
+
+void uuid_sprintf(benchmark::State& state) { run_uuid(state, sprintf_uuid); }
+BENCHMARK(uuid_sprintf);
+
+void uuid_kernel(benchmark::State& state) {
+  run_uuid(state, [](char* out, const uuid& u) {
+    return format_uuid(out, u);
+  });
+}
+BENCHMARK(uuid_kernel);
+
+#ifdef HAVE_SIMD
+void uuid_ssse3(benchmark::State& state) {
+  if (!__builtin_cpu_supports("ssse3")) {
+    state.SkipWithError("SSSE3 is not supported");
+    return;
+  }
+  run_uuid(state, format_uuid_ssse3);
+}
+BENCHMARK(uuid_ssse3);
+#endif
+
+void uuid_fmt_formatter(benchmark::State& state) {
+  run_uuid(state, [](char* out, const uuid& u) {
+    return fmt::format_to(out, "{}", u);
+  });
+}
+BENCHMARK(uuid_fmt_formatter);
@@ -0,0 +1,153 @@
+// A benchmark of zero-padded and width-aligned integer formatting such as
+// "%08d", "{:08}" and "{:>12}" common in timestamps, IDs and table columns.
+//
+// Copyright (c) 2019 - present, Victor Zverovich
+// All rights reserved.
+
+#include <benchmark/benchmark.h>
+#include <fmt/compile.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "digits10/digits10.h"
+#include "int-benchmark-data.h"
+#include "itoa-benchmark/digitslut.h"
+
+#define STB_SPRINTF_IMPLEMENTATION
+#include "stb_sprintf.h"
+
+// The fill and alignment, reported as the fill argument 0, 1 or 2:
+// "{:0{}}", "{:>{}}" and "{:*>{}}" in fmt. printf has no custom fill so it
+// only supports zero and space.
+enum fill { zero, space, star };
+
+const std::vector<int> values = generate_values(1'000'000);
+
+// Writes value padded to width in a single right-to-left pass. With zero fill
+// the digit loop simply runs for the whole width since the quotient becomes
+// zero so there is no separate fill pass; otherwise the fill is written after
+// the sign in the remaining prefix.
+char* format_padded(char* out, int value, int width, fill f) {
+  auto abs_value = static_cast<uint32_t>(value);
+  if (value < 0) abs_value = 0 - abs_value;
+  int num_digits = digits10_fmt64(abs_value);
+  int sign_size = value < 0 ? 1 : 0;
+  int size = (std::max)(width, num_digits + sign_size);
+  char* end = out + size;
+  char* p = end;
+  char* digits_begin = f == zero ? out + sign_size : end - num_digits;
+  while (p - digits_begin >= 2) {
+    unsigned d = (abs_value % 100) * 2;
+    abs_value /= 100;
+    *--p = gDigitsLut[d + 1];
+    *--p = gDigitsLut[d];
+  }
+  if (p != digits_begin) *--p = static_cast<char>('0' + abs_value);
+  if (f == zero) {
+    if (sign_size) *out = '-';
+    return end;
+  }
+  if (sign_size) *--p = '-';
+  std::memset(out, f == space ? ' ' : '*', p - out);
+  return end;
+}
+
+// Returns the expected output for all values produced by snprintf.
+const std::string& get_expected(int width, fill f) {
+  static std::string expected[3][33];
+  auto& result = expected[f][width];
+  if (!result.empty()) return result;
+  for (auto value : values) {
+    char buffer[32];
+    const char* format = f == zero ? "%0*d" : "%*d";
+    int size = std::snprintf(buffer, sizeof(buffer), format, width, value);
+    if (f == star) std::replace(buffer, buffer + size, ' ', '*');
+    result.append(buffer, size);
+  }
+  return result;
+}
+
+template <typename F> void run(benchmark::State& state, F format) {
+  int width = static_cast<int>(state.range(0));
+  auto f = static_cast<fill>(state.range(1));
+  for (auto s : state) {
+    for (auto value : values) {
+      char buffer[32];
+      format(buffer, value, width, f);
+      benchmark::DoNotOptimize(buffer);
+    }
+  }
+  const auto& expected = get_expected(width, f);
+  std::string actual;
+  for (auto value : values) {
+    char buffer[32];
+    actual.append(buffer, format(buffer, value, width, f));
+  }
+  if (actual != expected) throw std::logic_error("invalid output");
+  state.SetItemsProcessed(state.iterations() * values.size());
+  state.SetBytesProcessed(state.iterations() * expected.size());
+}
+
+void printf_args(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"width", "fill"})->ArgsProduct({{4, 8, 12, 16}, {zero, space}});
+}
+
+void fmt_args(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"width", "fill"})
+      ->ArgsProduct({{4, 8, 12, 16}, {zero, space, star}});
+}
+
+void sprintf(benchmark::State& state) {
+  run(state, [](char* out, int value, int width, fill f) {
+    return out + std::sprintf(out, f == zero ? "%0*d" : "%*d", width, value);
+  });
+}
+BENCHMARK(sprintf)->Apply(printf_args);
+
+void stb_sprintf(benchmark::State& state) {
+  run(state, [](char* out, int value, int width, fill f) {
+    return out + stbsp_sprintf(out, f == zero ? "%0*d" : "%*d", width, value);
+  });
+}
+BENCHMARK(stb_sprintf)->Apply(printf_args);
+
+void fmt_runtime(benchmark::State& state) {
+  run(state, [](char* out, int value, int width, fill f) {
+    switch (f) {
+    case zero:
+      return fmt::format_to(out, "{:0{}}", value, width);
+    case space:
+      return fmt::format_to(out, "{:>{}}", value, width);
+    case star:
+      break;
+    }
+    return fmt::format_to(out, "{:*>{}}", value, width);
+  });
+}
+BENCHMARK(fmt_runtime)->Apply(fmt_args);
+
+void fmt_compile(benchmark::State& state) {
+  run(state, [](char* out, int value, int width, fill f) {
+    switch (f) {
+    case zero:
+      return fmt::format_to(out, FMT_COMPILE("{:0{}}"), value, width);
+    case space:
+      return fmt::format_to(out, FMT_COMPILE("{:>{}}"), value, width);
+    case star:
+      break;
+    }
+    return fmt::format_to(out, FMT_COMPILE("{:*>{}}"), value, width);
+  });
+}
+BENCHMARK(fmt_compile)->Apply(fmt_args);
+
+void padded_kernel(benchmark::State& state) {
+  run(state, format_padded);
+}
+BENCHMARK(padded_kernel)->Apply(fmt_args);
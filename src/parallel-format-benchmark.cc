@@ -0,0 +1,147 @@
+// A benchmark of formatting a large array of integers into one contiguous
+// newline-separated column. The parallel method makes two passes: the first
+// one computes the output size of each chunk using digits10 and the second
+// one writes every chunk directly to its final position found by a prefix
+// sum of the chunk sizes.
+//
+// Copyright (c) 2019 - present, Victor Zverovich
+// All rights reserved.
+
+#include <benchmark/benchmark.h>
+#include <fmt/compile.h>
+
+#include <cassert>
+#include <charconv>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "digits10/digits10.h"
+#include "int-benchmark-data.h"
+
+struct Input {
+  std::vector<int> values;
+  size_t size = 0;  // Output size.
+  unsigned digest = 0;
+};
+
+// Returns values generated as in int-benchmark and the expected output.
+const Input& get_input(size_t n) {
+  static std::map<size_t, Input> inputs;
+  auto it = inputs.find(n);
+  if (it != inputs.end()) return it->second;
+  auto& input = inputs[n];
+  input.values = generate_values(n);
+  for (auto value : input.values) {
+    char buffer[13];
+    auto end = std::to_chars(buffer, buffer + sizeof(buffer) - 1, value).ptr;
+    *end++ = '\n';
+    input.size += end - buffer;
+    input.digest += compute_digest({buffer, static_cast<size_t>(end - buffer)});
+  }
+  return input;
+}
+
+// Returns the length of value formatted in decimal.
+inline size_t length(int value) {
+  auto abs_value = static_cast<uint32_t>(value);
+  if (value < 0) abs_value = 0 - abs_value;
+  return digits10_fmt64(abs_value) + (value < 0);
+}
+
+// Runs f(thread_index, begin, end) on num_threads threads each processing a
+// contiguous chunk of [0, n).
+template <typename F> void for_each_chunk(size_t n, unsigned num_threads, F f) {
+  std::vector<std::thread> threads;
+  size_t chunk_size = (n + num_threads - 1) / num_threads;
+  for (unsigned t = 0; t < num_threads; ++t) {
+    size_t begin = (std::min)(n, t * chunk_size);
+    size_t end = (std::min)(n, begin + chunk_size);
+    threads.emplace_back(f, t, begin, end);
+  }
+  for (auto& thread : threads) thread.join();
+}
+
+size_t parallel_format(const std::vector<int>& values, char* out,
+                       unsigned num_threads) {
+  std::vector<size_t> offsets(num_threads + 1);
+  for_each_chunk(values.size(), num_threads,
+                 [&](unsigned t, size_t begin, size_t end) {
+                   size_t size = 0;
+                   for (size_t i = begin; i < end; ++i)
+                     size += length(values[i]) + 1;
+                   offsets[t + 1] = size;
+                 });
+  // The number of chunks is small so the prefix sum is done serially.
+  std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+  for_each_chunk(values.size(), num_threads,
+                 [&](unsigned t, size_t begin, size_t end) {
+                   char* p = out + offsets[t];
+                   for (size_t i = begin; i < end; ++i)
+                     p = fmt::format_to(p, FMT_COMPILE("{}\n"), values[i]);
+                   assert(p == out + offsets[t + 1]);
+                 });
+  return offsets[num_threads];
+}
+
+template <typename F> void run(benchmark::State& state, F format) {
+  const auto& input = get_input(static_cast<size_t>(state.range(0)));
+  auto out = std::unique_ptr<char[]>(new char[input.values.size() * 12]);
+  size_t size = 0;
+  for (auto s : state) {
+    size = format(input.values, out.get());
+    benchmark::DoNotOptimize(out.get());
+  }
+  if (size != input.size ||
+      compute_digest({out.get(), size}) != input.digest) {
+    throw std::logic_error("invalid output");
+  }
+  state.SetItemsProcessed(state.iterations() * input.values.size());
+  state.SetBytesProcessed(state.iterations() * input.size);
+}
+
+void serial_fmt_format_to(benchmark::State& state) {
+  run(state, [](const std::vector<int>& values, char* out) -> size_t {
+    char* p = out;
+    for (auto value : values)
+      p = fmt::format_to(p, FMT_COMPILE("{}\n"), value);
+    return p - out;
+  });
+}
+BENCHMARK(serial_fmt_format_to)
+    ->ArgName("size")
+    ->Arg(1'000'000)
+    ->Arg(10'000'000)
+    ->Arg(100'000'000)
+    ->UseRealTime();
+
+void serial_std_to_chars(benchmark::State& state) {
+  run(state, [](const std::vector<int>& values, char* out) -> size_t {
+    char* p = out;
+    for (auto value : values) {
+      p = std::to_chars(p, p + 11, value).ptr;
+      *p++ = '\n';
+    }
+    return p - out;
+  });
+}
+BENCHMARK(serial_std_to_chars)
+    ->ArgName("size")
+    ->Arg(1'000'000)
+    ->Arg(10'000'000)
+    ->Arg(100'000'000)
+    ->UseRealTime();
+
+void parallel_two_pass(benchmark::State& state) {
+  auto num_threads = static_cast<unsigned>(state.range(1));
+  run(state, [num_threads](const std::vector<int>& values, char* out) {
+    return parallel_format(values, out, num_threads);
+  });
+}
+BENCHMARK(parallel_two_pass)
+    ->ArgNames({"size", "threads"})
+    ->ArgsProduct({{1'000'000, 10'000'000, 100'000'000}, {1, 2, 4, 8, 16}})
+    ->UseRealTime();
@@ -0,0 +1,229 @@
+// A benchmark of hexadecimal, octal and binary integer to string conversion
+// used for hashes, addresses and trace IDs.
+//
+// Copyright (c) 2019 - present, Victor Zverovich
+// All rights reserved.
+
+#include <benchmark/benchmark.h>
+#include <fmt/compile.h>
+
+#include <charconv>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#  include <immintrin.h>
+#  define HAVE_SSSE3
+#endif
+
+template <int Base> constexpr int bits_per_digit = Base == 16 ? 4
+                                                   : Base == 8 ? 3
+                                                               : 1;
+
+template <int Base> constexpr int max_digits =
+    (64 + bits_per_digit<Base> - 1) / bits_per_digit<Base>;
+
+// Returns the number of digits of value in base 2^bits.
+inline int count_digits(uint64_t value, int bits) {
+  int num_bits = 64 - __builtin_clzll(value | 1);
+  return (num_bits + bits - 1) / bits;
+}
+
+struct Input {
+  std::vector<uint64_t> values;
+  std::string expected;  // Concatenated output of std::to_chars.
+};
+
+// Returns 100'000 values with the given number of digits in Base or, if
+// num_digits is 0, 1'000'000 values with uniformly distributed digit counts.
+template <int Base> const Input& get_input(int num_digits) {
+  static std::map<int, Input> inputs;
+  auto it = inputs.find(num_digits);
+  if (it != inputs.end()) return it->second;
+  auto& input = inputs[num_digits];
+  std::mt19937_64 gen(num_digits);
+  std::uniform_int_distribution<int> digits_dist(1, max_digits<Base>);
+  input.values.resize(num_digits != 0 ? 100'000 : 1'000'000);
+  for (auto& value : input.values) {
+    int n = num_digits != 0 ? num_digits : digits_dist(gen);
+    int num_bits = (std::min)(n * bits_per_digit<Base>, 64);
+    // Set the top bit of the last digit to get exactly n digits.
+    int top_bit = (n - 1) * bits_per_digit<Base>;
+    value = (gen() >> (64 - num_bits)) | (uint64_t(1) << top_bit);
+    char buffer[64];
+    auto end = std::to_chars(buffer, buffer + sizeof(buffer), value, Base).ptr;
+    input.expected.append(buffer, end);
+  }
+  return input;
+}
+
+// Converts values to Base with format and checks that the output matches
+// std::to_chars.
+template <int Base, typename F> void run(benchmark::State& state, F format) {
+  const auto& input = get_input<Base>(static_cast<int>(state.range(0)));
+  size_t size = 0;
+  for (auto s : state) {
+    for (auto value : input.values) {
+      char buffer[64];
+      size += format(buffer, value) - buffer;
+      benchmark::DoNotOptimize(buffer);
+    }
+  }
+  benchmark::DoNotOptimize(size);
+  std::string actual;
+  for (auto value : input.values) {
+    char buffer[64];
+    actual.append(buffer, format(buffer, value));
+  }
+  if (actual != input.expected) throw std::logic_error("invalid output");
+  state.SetItemsProcessed(state.iterations() * input.values.size());
+  state.SetBytesProcessed(state.iterations() * input.expected.size());
+}
+
+// Runs with every digit count (every 4th in binary) and with random digit
+// counts reported as digits:0.
+template <int Base> void digit_args(benchmark::internal::Benchmark* b) {
+  b->ArgName("digits")->Arg(0);
+  int step = Base == 2 ? 4 : 1;
+  for (int n = 1; n <= max_digits<Base>; n = n < step ? step : n + step)
+    b->Arg(n);
+}
+
+template <int Base> void fmt_format_to(benchmark::State& state) {
+  run<Base>(state, [](char* out, uint64_t value) {
+    if constexpr (Base == 16)
+      return fmt::format_to(out, "{:x}", value);
+    else if constexpr (Base == 8)
+      return fmt::format_to(out, "{:o}", value);
+    else
+      return fmt::format_to(out, "{:b}", value);
+  });
+}
+
+template <int Base> void fmt_format_to_compile(benchmark::State& state) {
+  run<Base>(state, [](char* out, uint64_t value) {
+    if constexpr (Base == 16)
+      return fmt::format_to(out, FMT_COMPILE("{:x}"), value);
+    else if constexpr (Base == 8)
+      return fmt::format_to(out, FMT_COMPILE("{:o}"), value);
+    else
+      return fmt::format_to(out, FMT_COMPILE("{:b}"), value);
+  });
+}
+
+// printf has no binary conversion before C23.
+template <int Base> void sprintf(benchmark::State& state) {
+  static_assert(Base != 2, "unsupported base");
+  run<Base>(state, [](char* out, uint64_t value) {
+    return out + std::sprintf(out, Base == 16 ? "%" PRIx64 : "%" PRIo64, value);
+  });
+}
+
+template <int Base> void std_to_chars(benchmark::State& state) {
+  run<Base>(state, [](char* out, uint64_t value) {
+    return std::to_chars(out, out + 64, value, Base).ptr;
+  });
+}
+
+// A table of all digit groups of Base that fit in a byte (6 bits in octal),
+// e.g. "00", "01", ..., "ff" in hex.
+template <int Base> struct group_table {
+  static constexpr int group_bits = Base == 8 ? 6 : 8;
+  static constexpr int group_digits = group_bits / bits_per_digit<Base>;
+  char entries[1 << group_bits][group_digits];
+
+  constexpr group_table() : entries() {
+    for (int group = 0; group < (1 << group_bits); ++group) {
+      for (int i = 0; i < group_digits; ++i) {
+        int shift = (group_digits - 1 - i) * bits_per_digit<Base>;
+        entries[group][i] = "0123456789abcdef"[(group >> shift) & (Base - 1)];
+      }
+    }
+  }
+};
+
+template <int Base> inline constexpr group_table<Base> groups{};
+
+// Writes digits right to left one table entry (two hex or octal digits or
+// eight binary digits) at a time. This uses byte-sized groups rather than a
+// 16-entry nibble table since a nibble table only gives one hex digit per
+// lookup, no better than indexing "0123456789abcdef" directly.
+template <int Base> char* format_lut(char* out, uint64_t value) {
+  using table = group_table<Base>;
+  char* end = out + count_digits(value, bits_per_digit<Base>);
+  char* p = end;
+  while (p - out >= table::group_digits) {
+    p -= table::group_digits;
+    auto group = value & ((1 << table::group_bits) - 1);
+    std::memcpy(p, groups<Base>.entries[group], table::group_digits);
+    value >>= table::group_bits;
+  }
+  if (p != out) {
+    // The remaining digits are the last ones of the entry.
+    const char* entry = groups<Base>.entries[value];
+    std::memcpy(out, entry + table::group_digits - (p - out), p - out);
+  }
+  return end;
+}
+
+template <int Base> void lut(benchmark::State& state) {
+  run<Base>(state, format_lut<Base>);
+}
+
+#ifdef HAVE_SSSE3
+// Converts all 16 nibbles at once: the nibbles are spread into bytes and
+// mapped to digits with pshufb, then the leading zeros are dropped.
+__attribute__((target("ssse3"))) char* format_hex_ssse3(char* out,
+                                                        uint64_t value) {
+  // Byte i of value in lanes 2i and 2i + 1.
+  auto reversed = static_cast<int64_t>(__builtin_bswap64(value));
+  __m128i bytes = _mm_cvtsi64_si128(reversed);
+  __m128i pairs = _mm_unpacklo_epi8(bytes, bytes);
+  __m128i hi = _mm_and_si128(_mm_srli_epi16(pairs, 4), _mm_set1_epi16(0x000f));
+  __m128i lo = _mm_and_si128(pairs, _mm_set1_epi16(0x0f00));
+  __m128i nibbles = _mm_or_si128(hi, lo);
+  __m128i digits = _mm_shuffle_epi8(
+      _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b',
+                    'c', 'd', 'e', 'f'),
+      nibbles);
+  char buffer[16];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(buffer), digits);
+  int num_digits = count_digits(value, 4);
+  std::memcpy(out, buffer + 16 - num_digits, num_digits);
+  return out + num_digits;
+}
+
+void ssse3(benchmark::State& state) {
+  if (!__builtin_cpu_supports("ssse3")) {
+    state.SkipWithError("SSSE3 is not supported");
+    return;
+  }
+  run<16>(state, format_hex_ssse3);
+}
+BENCHMARK(ssse3)->Apply(digit_args<16>);
+#endif
+
+BENCHMARK_TEMPLATE(fmt_format_to, 16)->Apply(digit_args<16>);
+BENCHMARK_TEMPLATE(fmt_format_to_compile, 16)->Apply(digit_args<16>);
+BENCHMARK_TEMPLATE(sprintf, 16)->Apply(digit_args<16>);
+BENCHMARK_TEMPLATE(std_to_chars, 16)->Apply(digit_args<16>);
+BENCHMARK_TEMPLATE(lut, 16)->Apply(digit_args<16>);
+
+BENCHMARK_TEMPLATE(fmt_format_to, 8)->Apply(digit_args<8>);
+BENCHMARK_TEMPLATE(fmt_format_to_compile, 8)->Apply(digit_args<8>);
+BENCHMARK_TEMPLATE(sprintf, 8)->Apply(digit_args<8>);
+BENCHMARK_TEMPLATE(std_to_chars, 8)->Apply(digit_args<8>);
+BENCHMARK_TEMPLATE(lut, 8)->Apply(digit_args<8>);
+
+BENCHMARK_TEMPLATE(fmt_format_to, 2)->Apply(digit_args<2>);
+BENCHMARK_TEMPLATE(fmt_format_to_compile, 2)->Apply(digit_args<2>);
+BENCHMARK_TEMPLATE(std_to_chars, 2)->Apply(digit_args<2>);
+BENCHMARK_TEMPLATE(lut, 2)->Apply(digit_args<2>);
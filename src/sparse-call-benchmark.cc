@@ -0,0 +1,144 @@
+// A benchmark of formatting calls that are sparse as in services that format
+// one log line per request with a lot of unrelated code in between. Before
+// each timed call a number of distinct functions are called in random order
+// to evict the formatting code from the instruction cache. This shows whether
+// compiled format strings, which inline more code, keep their advantage when
+// the code is cold.
+//
+// Copyright (c) 2019 - present, Victor Zverovich
+// All rights reserved.
+
+#include <benchmark/benchmark.h>
+#include <fmt/compile.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#define STB_SPRINTF_IMPLEMENTATION
+#include "stb_sprintf.h"
+
+constexpr unsigned num_polluters = 8192;
+
+// Distinct constants prevent the linker from folding identical functions.
+// Each instantiation is about 100-200 bytes of code.
+template <unsigned N> FMT_NOINLINE uint64_t pollute(uint64_t x) {
+  x = x * (2 * N + 1) + N;
+  x ^= x >> (N % 29 + 1);
+  x = x * 0x9E3779B97F4A7C15 + (N ^ 0x5555);
+  x ^= x << (N % 13 + 3);
+  x = x * (4 * N + 3) - (N >> 2);
+  x ^= x >> (N % 31 + 1);
+  x = x * 0xC2B2AE3D27D4EB4F + (N * 7);
+  x ^= x >> (N % 23 + 5);
+  return x;
+}
+
+using polluter = uint64_t (*)(uint64_t);
+
+template <size_t... Is>
+auto make_polluters(std::index_sequence<Is...>) {
+  return std::vector<polluter>{pollute<Is>...};
+}
+
+struct Polluters {
+  std::vector<polluter> functions =
+      make_polluters(std::make_index_sequence<num_polluters>());
+  size_t index = 0;
+  uint64_t state = 0;
+
+  Polluters() {
+    std::shuffle(functions.begin(), functions.end(), std::mt19937());
+  }
+
+  // Calls the next count functions in random order.
+  void run(size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      state = functions[index](state);
+      if (++index == functions.size()) index = 0;
+    }
+    benchmark::DoNotOptimize(state);
+  }
+} polluters;
+
+// Times single calls of format, each preceded by calling state.range(0)
+// unrelated functions. The number of iterations is fixed because the minimum
+// time is compared to the manual time which excludes the pollution.
+template <typename F> void run(benchmark::State& state, F format) {
+  auto count = static_cast<size_t>(state.range(0));
+  const char* file = "sparse-call-benchmark.cc";
+  int line = 42;
+  const char* name = "handle_request";
+  double millis = 3.14159;
+  size_t size = 0;
+  char buffer[256];
+  for (auto s : state) {
+    polluters.run(count);
+    benchmark::DoNotOptimize(file);
+    benchmark::DoNotOptimize(line);
+    benchmark::DoNotOptimize(name);
+    benchmark::DoNotOptimize(millis);
+    auto start = std::chrono::steady_clock::now();
+    size += format(buffer, file, line, name, millis);
+    benchmark::DoNotOptimize(buffer);
+    auto end = std::chrono::steady_clock::now();
+    state.SetIterationTime(std::chrono::duration<double>(end - start).count());
+  }
+  if (size != state.iterations() *
+                  std::strlen("sparse-call-benchmark.cc:42: handle_request "
+                              "took 3.142 ms\n"))
+    throw std::logic_error("invalid size");
+}
+
+void sparse_args(benchmark::internal::Benchmark* b) {
+  b->ArgName("polluters")
+      ->Arg(0)
+      ->Arg(1024)
+      ->Arg(num_polluters)
+      ->UseManualTime()
+      ->Iterations(20000);
+}
+
+void sprintf(benchmark::State& state) {
+  run(state, [](char* buf, const char* file, int line, const char* name,
+                double millis) -> size_t {
+    return std::sprintf(buf, "%s:%d: %s took %.3f ms\n", file, line, name,
+                        millis);
+  });
+}
+BENCHMARK(sprintf)->Apply(sparse_args);
+
+void stb_sprintf(benchmark::State& state) {
+  run(state, [](char* buf, const char* file, int line, const char* name,
+                double millis) -> size_t {
+    return stbsp_sprintf(buf, "%s:%d: %s took %.3f ms\n", file, line, name,
+                         millis);
+  });
+}
+BENCHMARK(stb_sprintf)->Apply(sparse_args);
+
+void fmt_format_to_runtime(benchmark::State& state) {
+  run(state, [](char* buf, const char* file, int line, const char* name,
+                double millis) -> size_t {
+    return fmt::format_to(buf, "{}:{}: {} took {:.3f} ms\n", file, line, name,
+                          millis) -
+           buf;
+  });
+}
+BENCHMARK(fmt_format_to_runtime)->Apply(sparse_args);
+
+void fmt_format_to_compile(benchmark::State& state) {
+  run(state, [](char* buf, const char* file, int line, const char* name,
+                double millis) -> size_t {
+    return fmt::format_to(buf, FMT_COMPILE("{}:{}: {} took {:.3f} ms\n"), file,
+                          line, name, millis) -
+           buf;
+  });
+}
+BENCHMARK(fmt_format_to_compile)->Apply(sparse_args);
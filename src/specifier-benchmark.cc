@@ -0,0 +1,108 @@
+// A per-specifier breakdown of the tinyformat speed test format string
+// "%0.10f:%04d:%+g:%s:%p:%c:%%\n" that times each conversion on its own.
+//
+// Copyright (c) 2019 - present, Victor Zverovich
+// All rights reserved.
+
+#include <benchmark/benchmark.h>
+#include <fmt/compile.h>
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+#define STB_SPRINTF_IMPLEMENTATION
+#include "stb_sprintf.h"
+#include "tinyformat.h"
+
+// Formats into a stack buffer with every method so that the results are not
+// affected by I/O as in speed-test. The arguments are passed through
+// DoNotOptimize to prevent compilers from formatting them at compile time.
+template <typename F, typename... Args>
+void run(benchmark::State& state, F format, Args... args) {
+  char buffer[100];
+  size_t size = 0;
+  for (auto s : state) {
+    (benchmark::DoNotOptimize(args), ...);
+    size += format(buffer, args...);
+    benchmark::DoNotOptimize(buffer);
+  }
+  state.SetItemsProcessed(state.iterations());
+  benchmark::DoNotOptimize(size);
+}
+
+template <typename... Args>
+void run_tinyformat(benchmark::State& state, const char* format,
+                    Args... args) {
+  std::ostringstream os;
+  size_t size = 0;
+  for (auto s : state) {
+    (benchmark::DoNotOptimize(args), ...);
+    os.str(std::string());
+    tfm::format(os, format, args...);
+    size += os.tellp();
+  }
+  state.SetItemsProcessed(state.iterations());
+  benchmark::DoNotOptimize(size);
+}
+
+// Defines benchmarks of a single conversion for each formatting method.
+// printf_format and fmt_format must be string literals.
+#define SPECIFIER_BENCHMARK(name, printf_format, fmt_format, ...)             \
+  void name##_printf(benchmark::State& state) {                               \
+    run(                                                                      \
+        state,                                                                \
+        [](char* buf, auto... args) {                                         \
+          return std::snprintf(buf, 100, printf_format, args...);             \
+        },                                                                    \
+        __VA_ARGS__);                                                         \
+  }                                                                           \
+  BENCHMARK(name##_printf);                                                   \
+                                                                              \
+  void name##_stb_sprintf(benchmark::State& state) {                          \
+    run(                                                                      \
+        state,                                                                \
+        [](char* buf, auto... args) {                                         \
+          return stbsp_snprintf(buf, 100, printf_format, args...);            \
+        },                                                                    \
+        __VA_ARGS__);                                                         \
+  }                                                                           \
+  BENCHMARK(name##_stb_sprintf);                                              \
+                                                                              \
+  void name##_fmt_runtime(benchmark::State& state) {                          \
+    run(                                                                      \
+        state,                                                                \
+        [](char* buf, auto... args) {                                         \
+          return fmt::format_to(buf, fmt_format, args...) - buf;              \
+        },                                                                    \
+        __VA_ARGS__);                                                         \
+  }                                                                           \
+  BENCHMARK(name##_fmt_runtime);                                              \
+                                                                              \
+  void name##_fmt_compile(benchmark::State& state) {                          \
+    run(                                                                      \
+        state,                                                                \
+        [](char* buf, auto... args) {                                         \
+          return fmt::format_to(buf, FMT_COMPILE(fmt_format), args...) - buf; \
+        },                                                                    \
+        __VA_ARGS__);                                                         \
+  }                                                                           \
+  BENCHMARK(name##_fmt_compile);                                              \
+                                                                              \
+  void name##_tinyformat(benchmark::State& state) {                           \
+    run_tinyformat(state, printf_format, __VA_ARGS__);                        \
+  }                                                                           \
+  BENCHMARK(name##_tinyformat);
+
+// The arguments are the same as in speedTest() in tinyformat-test.cc.
+SPECIFIER_BENCHMARK(fixed, "%0.10f", "{:.10f}", 1.234)
+SPECIFIER_BENCHMARK(zero_pad, "%04d", "{:04}", 42)
+SPECIFIER_BENCHMARK(plus_general, "%+g", "{:+}", 3.13)
+SPECIFIER_BENCHMARK(string, "%s", "{}", "str")
+SPECIFIER_BENCHMARK(pointer, "%p", "{}", (void*)1000)
+SPECIFIER_BENCHMARK(character, "%c", "{}", 'X')
+
+// The whole format string for reference.
+SPECIFIER_BENCHMARK(all, "%0.10f:%04d:%+g:%s:%p:%c:%%\n",
+                    "{:.10f}:{:04}:{:+}:{}:{}:{}:%\n", 1.234, 42, 3.13, "str",
+                    (void*)1000, 'X')
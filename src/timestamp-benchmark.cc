@@ -0,0 +1,158 @@
+// A benchmark of formatting log line timestamps "YYYY-MM-DD HH:MM:SS.uuuuuu"
+// in UTC at different call rates. The cached method only recomputes the date
+// and time when the second changes so it benefits from high call rates.
+//
+// Copyright (c) 2019 - present, Victor Zverovich
+// All rights reserved.
+
+#include <benchmark/benchmark.h>
+#include <fmt/chrono.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "itoa-benchmark/digitslut.h"
+
+constexpr size_t timestamp_size = 26;
+
+struct Input {
+  std::vector<int64_t> timestamps;  // Microseconds since the epoch.
+  std::string expected;             // strftime and snprintf output.
+};
+
+char* format_strftime(char* out, int64_t timestamp) {
+  std::tm tm = fmt::gmtime(timestamp / 1'000'000);
+  size_t size = std::strftime(out, 20, "%Y-%m-%d %H:%M:%S", &tm);
+  return out + size + std::snprintf(out + size, 8, ".%06d",
+                                    static_cast<int>(timestamp % 1'000'000));
+}
+
+// Returns 100'000 increasing timestamps from a log with calls_per_second
+// lines per second at random times.
+const Input& get_input(int64_t calls_per_second) {
+  static std::map<int64_t, Input> inputs;
+  auto it = inputs.find(calls_per_second);
+  if (it != inputs.end()) return it->second;
+  auto& input = inputs[calls_per_second];
+  std::mt19937_64 gen;
+  int64_t interval = 1'000'000 / calls_per_second;
+  int64_t timestamp = 1'700'000'000'000'000;  // 2023-11-14 22:13:20 UTC
+  input.timestamps.resize(100'000);
+  for (auto& t : input.timestamps) {
+    timestamp += gen() % (2 * interval) + 1;
+    t = timestamp;
+    char buffer[64];
+    input.expected.append(buffer, format_strftime(buffer, t));
+  }
+  return input;
+}
+
+template <typename F> void run(benchmark::State& state, F format) {
+  const auto& input = get_input(state.range(0));
+  size_t size = 0;
+  for (auto s : state) {
+    for (auto t : input.timestamps) {
+      char buffer[64];
+      size += format(buffer, t) - buffer;
+      benchmark::DoNotOptimize(buffer);
+    }
+  }
+  benchmark::DoNotOptimize(size);
+  std::string actual;
+  for (auto t : input.timestamps) {
+    char buffer[64];
+    actual.append(buffer, format(buffer, t));
+  }
+  if (actual != input.expected) throw std::logic_error("invalid output");
+  state.SetItemsProcessed(state.iterations() * input.timestamps.size());
+}
+
+void rate_args(benchmark::internal::Benchmark* b) {
+  b->ArgName("calls_per_second")->RangeMultiplier(100)->Range(1, 1'000'000);
+}
+
+// %S of a time point with microsecond precision includes the fraction.
+void fmt_format_to(benchmark::State& state) {
+  run(state, [](char* out, int64_t timestamp) {
+    using sys_time_us = std::chrono::time_point<std::chrono::system_clock,
+                                                 std::chrono::microseconds>;
+    return fmt::format_to(out, "{:%Y-%m-%d %H:%M:%S}",
+                          sys_time_us(std::chrono::microseconds(timestamp)));
+  });
+}
+BENCHMARK(fmt_format_to)->Apply(rate_args);
+
+void strftime_snprintf(benchmark::State& state) {
+  run(state, format_strftime);
+}
+BENCHMARK(strftime_snprintf)->Apply(rate_args);
+
+// Writes value < 100 with exactly two digits.
+inline char* write2(char* out, unsigned value) {
+  std::memcpy(out, gDigitsLut + value * 2, 2);
+  return out + 2;
+}
+
+// Formats timestamps recomputing the "YYYY-MM-DD HH:MM:SS" prefix only when
+// the second changes. The microseconds are written with a fixed-width
+// kernel.
+class cached_formatter {
+ private:
+  int64_t second_ = -1;
+  char prefix_[19];
+
+ public:
+  char* format(char* out, int64_t timestamp) {
+    int64_t second = timestamp / 1'000'000;
+    if (second != second_) {
+      second_ = second;
+      std::tm tm = fmt::gmtime(second);
+      unsigned year = tm.tm_year + 1900;
+      char* p = write2(prefix_, year / 100);
+      p = write2(p, year % 100);
+      *p++ = '-';
+      p = write2(p, tm.tm_mon + 1);
+      *p++ = '-';
+      p = write2(p, tm.tm_mday);
+      *p++ = ' ';
+      p = write2(p, tm.tm_hour);
+      *p++ = ':';
+      p = write2(p, tm.tm_min);
+      *p++ = ':';
+      write2(p, tm.tm_sec);
+    }
+    std::memcpy(out, prefix_, sizeof(prefix_));
+    out[19] = '.';
+    auto micros = static_cast<unsigned>(timestamp % 1'000'000);
+    write2(out + 20, micros / 10000);
+    write2(out + 22, micros / 100 % 100);
+    write2(out + 24, micros % 100);
+    return out + timestamp_size;
+  }
+};
+
+void cached(benchmark::State& state) {
+  cached_formatter formatter;
+  run(state, [&formatter](char* out, int64_t timestamp) {
+    return formatter.format(out, timestamp);
+  });
+  // Report the fraction of calls that recompute the prefix.
+  const auto& timestamps = get_input(state.range(0)).timestamps;
+  size_t misses = 0;
+  int64_t second = -1;
+  for (auto t : timestamps) {
+    if (t / 1'000'000 != second) ++misses;
+    second = t / 1'000'000;
+  }
+  state.counters["miss_rate"] =
+      static_cast<double>(misses) / timestamps.size();
+}
+BENCHMARK(cached)->Apply(rate_args);
@@ -69,5 +69,3 @@ void test_format_pos(benchmark::State &state) {
 }
 
 BENCHMARK(test_format_pos);
-
-BENCHMARK_MAIN();
@@ -24,6 +24,9 @@ parser_bench.add_argument('min', type=int, help='minimum number of arguments')
 parser_bench.add_argument('max', type=int, help='maximum number of arguments')
 parser_bench.add_argument('num_translation_units', metavar='N', type=int,
                           help='number of translation units')
+parser_bench.add_argument('--run', action='store_true',
+                          help='also run the generated code formatting into '
+                               'an in-memory sink and measure ns per call')
 
 parser_plot = subparsers.add_parser('plot', help='plot the results')
 parser_plot.add_argument('--filename', type=str, default='variadic-test.pkl',
@@ -51,6 +54,9 @@ prefix = '_variadic_test_tmp_'
 NUM_RUNS = 3
 use_clobber = False
 
+# The number of formatting statements per argument in a generated function.
+STATEMENTS_PER_ARG = 5
+
 configs = [
   ('optimized', ['-O3', '-DNDEBUG']),
   ('debug',     [])
@@ -67,26 +73,32 @@ methods = [
 method_templates = {
   'boost': {
     'statement': r'std::cout << boost::format("{fmt_str}\n") % {args};',
+    'run_statement': r'sink << boost::format("{fmt_str}\n") % {args};',
     'sep': ' % ',
     'specifier': '%{type}',
   },
   'fmt': {
     'statement': r'fmt::print("{fmt_str}\n", {args});',
+    'run_statement':
+      r'fmt::format_to(std::back_inserter(sink), "{fmt_str}\n", {args});',
     'sep': ', ',
     'specifier': '{{:{type}}}',
   },
   'iostream': {
     'statement': r'std::cout << {args} << "\n";',
+    'run_statement': r'sink << {args} << "\n";',
     'sep': ' << ":" << ',
     'specifier': '',
   },
   'tinyformat': {
     'statement': r'tfm::printf("{fmt_str}\n", {args});',
+    'run_statement': r'tfm::format(sink, "{fmt_str}\n", {args});',
     'sep': ', ',
     'specifier': '%{type}',
   },
   'printf': {
     'statement': r'::printf("{fmt_str}\n", {args});',
+    'run_statement': r'sink_end += ::sprintf(sink_end, "{fmt_str}\n", {args});',
     'sep': ', ',
     'specifier': '%{type}',
   }
@@ -127,6 +139,110 @@ main_template = r'''
 #endif
 '''
 
+# Same as main_template but formats into an in-memory sink defined in main.
+run_main_template = r'''
+#ifdef USE_BOOST
+
+#include <boost/format.hpp>
+#include <sstream>
+
+extern std::ostringstream sink;
+
+{boost}
+
+#elif defined(USE_FMT)
+
+#include <iterator>
+#include "fmt/format.h"
+
+extern fmt::memory_buffer sink;
+
+{fmt}
+
+#elif defined(USE_IOSTREAMS)
+
+#include <sstream>
+
+extern std::ostringstream sink;
+
+{iostream}
+
+#elif defined(USE_TINYFORMAT)
+
+#include <sstream>
+#include "tinyformat.h"
+
+extern std::ostringstream sink;
+
+{tinyformat}
+
+#else
+
+#include <stdio.h>
+
+extern char* sink_end;
+
+{printf}
+
+#endif
+'''
+
+# The main function of the run mode. It runs all the generated functions
+# until at least 0.2s has elapsed, writes the output of one pass to stdout
+# for comparison between methods and the time per formatting call in
+# nanoseconds to stderr on a line starting with ns_per_call_marker.
+ns_per_call_marker = 'ns_per_call: '
+run_main_source = r'''
+#include <chrono>
+#include <stdio.h>
+#include <string>
+
+#if defined(USE_FMT)
+# include "fmt/format.h"
+fmt::memory_buffer sink;
+static void reset_sink() {{ sink.clear(); }}
+static std::string sink_contents() {{ return fmt::to_string(sink); }}
+#elif defined(USE_BOOST) || defined(USE_IOSTREAMS) || defined(USE_TINYFORMAT)
+# include <sstream>
+std::ostringstream sink;
+static void reset_sink() {{ sink.str(std::string()); }}
+static std::string sink_contents() {{ return sink.str(); }}
+#else
+static char sink_buffer[{sink_size}];
+char* sink_end = sink_buffer;
+static void reset_sink() {{ sink_end = sink_buffer; }}
+static std::string sink_contents() {{
+  return std::string(sink_buffer, sink_end);
+}}
+#endif
+
+static void run_all() {{
+{calls}}}
+
+int main() {{
+#if defined(USE_IOSTREAMS)
+  sink.setf(std::ios::fixed);
+  sink.precision(1);
+#endif
+  reset_sink();
+  run_all();
+  std::string output = sink_contents();
+  using clock = std::chrono::steady_clock;
+  auto start = clock::now();
+  long iterations = 0;
+  std::chrono::duration<double, std::nano> elapsed;
+  do {{
+    reset_sink();
+    run_all();
+    ++iterations;
+    elapsed = clock::now() - start;
+  }} while (elapsed < std::chrono::milliseconds(200));
+  fwrite(output.data(), 1, output.size(), stdout);
+  fprintf(stderr, "{marker}%f\n",
+          elapsed.count() / (iterations * {num_calls}.0));
+}}
+'''
+
 
 def make_format_string(method, args):
   specifiers = [method['specifier'].format(type=a[1]) for a in args]
@@ -138,7 +254,8 @@ def make_statement(method, args):
   if method['specifier']:
     d['fmt_str'] = make_format_string(method, args)
 
-  return method['statement'].format(**d)
+  statement = method['run_statement' if options.run else 'statement']
+  return statement.format(**d)
 
 
 def generate_args(start_n):
@@ -157,7 +274,7 @@ def generate_args(start_n):
 
 def make_function(func_def, method, n, num_args):
   from itertools import islice
-  mul = 5
+  mul = STATEMENTS_PER_ARG
   args = list(islice(generate_args(n), 2 * mul * num_args))
 
   statements = [make_statement(method, args[shift:shift + num_args])
@@ -177,7 +294,8 @@ def make_function(func_def, method, n, num_args):
 def make_template(func_def, n, num_args):
   functions = {k: make_function(func_def, v, n, num_args)
                for k, v in method_templates.items()}
-  return main_template.format(**functions)
+  template = run_main_template if options.run else main_template
+  return template.format(**functions)
 
 
 class Table:
@@ -222,6 +340,19 @@ def remove_old_files():
     os.remove(f)
 
 
+def generate_run_main(main_source, num_args):
+  calls = ''
+  for i in range(options.num_translation_units):
+    calls += '  doFormat_a{:03}(1, 1.0f, "String");\n'.format(i)
+  num_calls = options.num_translation_units * STATEMENTS_PER_ARG * num_args
+  with open(main_source, 'w') as cppfile:
+    cppfile.write('#include "{}all.h"\n'.format(prefix))
+    cppfile.write(run_main_source.format(
+      calls=calls, num_calls=num_calls, marker=ns_per_call_marker,
+      # Each argument takes less than 32 characters.
+      sink_size=num_calls * (num_args + 1) * 32))
+
+
 def generate_files(num_args):
   main_source = prefix + 'main.cc'
   main_header = prefix + 'all.h'
@@ -254,6 +385,8 @@ def generate_files(num_args):
       hppfile.write(func_def + ';\n')
     cppfile.write('}')
 
+  if options.run:
+    generate_run_main(main_source, num_args)
   return sources
 
 
@@ -273,6 +406,14 @@ def find_compiler():
   return compiler_path
 
 
+def parse_ns_per_call(err):
+  """Returns the time per call from the marker line in the run output"""
+  for line in err.splitlines():
+    if line.startswith(ns_per_call_marker):
+      return float(line[len(ns_per_call_marker):])
+  raise Exception('no run time in the output:\n' + err)
+
+
 def measure_compile(compiler_path, sources, flags):
   """Measure compile time and executable size"""
   output_filename = prefix + '.out'
@@ -294,9 +435,11 @@ def measure_compile(compiler_path, sources, flags):
   check_call(['strip', output_filename])
   result['stripped_size'] = os.stat(output_filename).st_size
 
-  p = Popen(['./' + output_filename], stdout=PIPE,
+  p = Popen(['./' + output_filename], stdout=PIPE, stderr=PIPE,
             env={'LD_LIBRARY_PATH': 'fmt'})
-  result['output'] = p.communicate()[0]
+  result['output'], err = p.communicate()
+  if options.run:
+    result['ns_per_call'] = parse_ns_per_call(err.decode())
   sys.stdout.flush()
 
   return result
@@ -318,6 +461,9 @@ def bench_single(num_args, flags):
       continue
 
     result['time'] = min(old_result['time'], result['time'])
+    if options.run:
+      result['ns_per_call'] = min(old_result['ns_per_call'],
+                                  result['ns_per_call'])
     if any(result[k] != old_result[k] for k in ('size', 'stripped_size')):
       raise Exception('size mismatch')
 
@@ -326,15 +472,21 @@ def bench_single(num_args, flags):
 
 def bench(method, config, flags):
   print('Benchmarking', config, method)
-  table = Table(
-    ['Args', 'Compile time, s', 'Executable size, KiB', 'Stripped size, KiB'],
-    ['', '.1f', '', '']
-  )
+  header = ['Args', 'Compile time, s', 'Executable size, KiB',
+            'Stripped size, KiB']
+  formats = ['', '.1f', '', '']
+  if options.run:
+    header.append('Run time, ns/call')
+    formats.append('.1f')
+  table = Table(header, formats)
   results = []
   for num_args in range(options.min, options.max):
     result = bench_single(num_args, flags)
-    table.print_row(num_args, result['time'], to_kib(result['size']),
-                    to_kib(result['stripped_size']))
+    row = [num_args, result['time'], to_kib(result['size']),
+           to_kib(result['stripped_size'])]
+    if options.run:
+      row.append(result['ns_per_call'])
+    table.print_row(*row)
     results.append(result)
   table.print_rulers()
   print()
@@ -401,6 +553,8 @@ def plot_subfigure(x, y, prop, **kwargs):
   plt.xlabel('number of arguments')
   if prop == 'time':
     plt.ylabel('compile time (s)')
+  elif prop == 'ns_per_call':
+    plt.ylabel('run time (ns/call)')
   else:
     plt.ylabel('binary size (MiB)')
 
@@ -435,9 +589,42 @@ def plot_all(filename, prop):
   plt.savefig('variadic-test_{}.png'.format(prop), bbox_inches='tight')
 
 
+def plot_tradeoff(filename):
+  """Plots compile time and run time of the optimized config side by side"""
+  data = load_data(filename)
+  x = np.arange(data['options'].min, data['options'].max)
+
+  set_plot_style()
+  plt.figure(figsize=(8, 3.5))
+
+  plt.subplot('121')
+  plot_title('compile time')
+  for method, _ in methods:
+    y = [result['time'] for result in data[method]['optimized']]
+    plot_subfigure(x, y, 'time', label=method)
+
+  plt.legend(loc='upper center', bbox_to_anchor=(1.05, 1.17),
+             ncol=5, fontsize=11)
+
+  plt.subplot('122')
+  plot_title('run time')
+  for method, _ in methods:
+    y = [result['ns_per_call'] for result in data[method]['optimized']]
+    plot_subfigure(x, y, 'ns_per_call', label=method)
+
+  plt.suptitle('variadic-test', fontsize=16, y=1.1)
+  plt.savefig('variadic-test_tradeoff.png', bbox_inches='tight')
+
+
 def plot_command():
-  for prop in 'time', 'size':
+  props = ['time', 'size']
+  has_run_data = getattr(load_data(options.filename)['options'], 'run', False)
+  if has_run_data:
+    props.append('ns_per_call')
+  for prop in props:
     plot_all(options.filename, prop)
+  if has_run_data:
+    plot_tradeoff(options.filename)
 
 
 def plot_diff(filenames, method, config, prop):